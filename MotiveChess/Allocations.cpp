@@ -0,0 +1,96 @@
+#include "Allocations.h"
+
+#ifdef COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<unsigned long long> allocationCount( 0 );
+
+// The array and nothrow forms of new and delete are defined by the standard library in terms of these, so replacing
+// the plain and aligned forms is enough to see every allocation
+
+void* operator new( std::size_t size )
+{
+    allocationCount.fetch_add( 1, std::memory_order_relaxed );
+
+    if ( void* memory = std::malloc( size ? size : 1 ) )
+    {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new( std::size_t size, std::align_val_t alignment )
+{
+    allocationCount.fetch_add( 1, std::memory_order_relaxed );
+
+    // aligned_alloc needs the size to be a multiple of the alignment
+    const std::size_t align = static_cast<std::size_t>( alignment );
+    const std::size_t alignedSize = ( ( size ? size : 1 ) + align - 1 ) & ~( align - 1 );
+
+#ifdef _WIN32
+    if ( void* memory = _aligned_malloc( alignedSize, align ) )
+#else
+    if ( void* memory = std::aligned_alloc( align, alignedSize ) )
+#endif
+    {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete( void* memory ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, std::size_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, std::align_val_t ) noexcept
+{
+#ifdef _WIN32
+    _aligned_free( memory );
+#else
+    std::free( memory );
+#endif
+}
+
+void operator delete( void* memory, std::size_t, std::align_val_t ) noexcept
+{
+#ifdef _WIN32
+    _aligned_free( memory );
+#else
+    std::free( memory );
+#endif
+}
+
+bool Allocations::isCounting()
+{
+    return true;
+}
+
+unsigned long long Allocations::getCount()
+{
+    return allocationCount.load( std::memory_order_relaxed );
+}
+
+#else
+
+bool Allocations::isCounting()
+{
+    return false;
+}
+
+unsigned long long Allocations::getCount()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+
+class Allocations
+{
+public:
+    /// <summary>
+    /// Whether this build counts heap allocations. Configure with COUNT_ALLOCATIONS to replace the global operator new
+    /// with one that counts calls, so that code that is meant to be allocation free (perft, the search) can be checked
+    /// </summary>
+    /// <returns>true if allocations are being counted</returns>
+    static bool isCounting();
+
+    /// <summary>
+    /// The number of heap allocations made so far by the whole program - always zero if not counting
+    /// </summary>
+    /// <returns>the allocation count</returns>
+    static unsigned long long getCount();
+};
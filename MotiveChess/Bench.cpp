@@ -0,0 +1,560 @@
+#include "Bench.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "Board.h"
+#include "Fen.h"
+#include "GoArguments.h"
+#include "Move.h"
+#include "MoveList.h"
+#include "TranspositionTable.h"
+
+void Bench::transpositionTableStress( const Engine& engine, unsigned int threadCount, unsigned int iterations )
+{
+    // A small set of keys, all mapping to a handful of buckets, so that threads are constantly writing
+    // over each other
+    static const unsigned short KEY_COUNT = 64;
+    static const unsigned long long BUCKET_SPREAD = 8;
+
+    TranspositionTable table;
+    table.resize( TranspositionTable::MIN_SIZE_MB );
+
+    std::vector<unsigned long long> keys;
+    unsigned long long seed = 0x9e3779b97f4a7c15ull;
+    for ( unsigned short loop = 0; loop < KEY_COUNT; loop++ )
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+
+        keys.push_back( ( seed & ~0xffffull ) | ( loop % BUCKET_SPREAD ) );
+    }
+
+    // The move and score stored for a key are derived from the key, so any entry that passes the key check but
+    // does not match these has been corrupted
+    auto expectedMove = [] ( unsigned long long key ) -> Move
+    {
+        return Move( ( key >> 16 ) & 63, ( key >> 22 ) & 63 );
+    };
+    auto expectedScore = [] ( unsigned long long key ) -> short
+    {
+        return static_cast<short>( ( key >> 28 ) & 0x3fff );
+    };
+
+    std::atomic<unsigned long long> probes( 0 );
+    std::atomic<unsigned long long> hits( 0 );
+    std::atomic<unsigned long long> corrupt( 0 );
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for ( unsigned int thread = 0; thread < threadCount; thread++ )
+    {
+        threads.push_back( std::thread( [&, thread] ()
+        {
+            unsigned long long state = 0x2545f4914f6cdd1dull * ( thread + 1 );
+            unsigned long long localProbes = 0;
+            unsigned long long localHits = 0;
+            unsigned long long localCorrupt = 0;
+
+            for ( unsigned int loop = 0; loop < iterations; loop++ )
+            {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+
+                const unsigned long long key = keys[ state % KEY_COUNT ];
+
+                if ( state & 0x100 )
+                {
+                    // Vary the depth so that concurrent writes of the same key still produce different data
+                    table.store( key, expectedMove( key ), expectedScore( key ), ( state >> 9 ) & 63, TranspositionTable::Bound::EXACT );
+                }
+                else
+                {
+                    Move move = Move::nullMove;
+                    short score;
+                    unsigned short depth;
+                    TranspositionTable::Bound bound;
+
+                    localProbes++;
+                    if ( table.probe( key, move, score, depth, bound ) )
+                    {
+                        localHits++;
+
+                        if ( !move.isEquivalent( expectedMove( key ) ) || score != expectedScore( key ) || bound != TranspositionTable::Bound::EXACT )
+                        {
+                            localCorrupt++;
+                        }
+                    }
+                }
+            }
+
+            probes += localProbes;
+            hits += localHits;
+            corrupt += localCorrupt;
+        } ) );
+    }
+
+    for ( std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); it++ )
+    {
+        ( *it ).join();
+    }
+
+    auto endTime = std::chrono::steady_clock::now();
+    long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>( endTime - startTime ).count();
+
+    engine.infoBroadcast( "string", "tt stress threads %u operations %llu probes %llu hits %llu tornreads %llu corrupt %llu time %lld",
+                          threadCount,
+                          static_cast<unsigned long long>( threadCount ) * iterations,
+                          probes.load(),
+                          hits.load(),
+                          table.getTornReads(),
+                          corrupt.load(),
+                          elapsed );
+}
+
+void Bench::selfPlayTiming( const Engine& engine, unsigned int games, unsigned int time, unsigned int increment )
+{
+    // Games still going after this many plies are abandoned, as there is no draw detection here
+    static const unsigned int MAX_PLIES = 200;
+
+    // Plies played at random at the start of each game
+    static const unsigned int RANDOM_PLIES = 2;
+
+    unsigned int timeLosses = 0;
+    unsigned long long moveCount = 0;
+    long long totalUsed = 0;
+    long long maxUsed = 0;
+    double totalShare = 0;
+
+    unsigned long long state = 0x9e3779b97f4a7c15ull;
+
+    for ( unsigned int game = 1; game <= games; game++ )
+    {
+        Board* board = Board::createBoard( Fen::startingPosition );
+
+        long long clocks[ 2 ] = { time, time };
+        const char* result = "unfinished";
+
+        unsigned int ply = 0;
+        for ( ; ply < MAX_PLIES; ply++ )
+        {
+            short score;
+            if ( board->isTerminal( score ) )
+            {
+                result = score == 0 ? "stalemate" : "checkmate";
+                break;
+            }
+
+            const bool white = board->whiteToPlay();
+            long long& clock = clocks[ white ? 0 : 1 ];
+
+            Move move = Move::nullMove;
+
+            if ( ply < RANDOM_PLIES )
+            {
+                MoveList moves;
+                board->getMoves( moves );
+
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+
+                move = moves[ state % moves.size() ];
+            }
+            else
+            {
+                GoArguments goArgs = GoArguments::Builder()
+                    .setWTime( static_cast<unsigned int>( clocks[ 0 ] ) )
+                    .setBTime( static_cast<unsigned int>( clocks[ 1 ] ) )
+                    .setWInc( increment )
+                    .setBInc( increment )
+                    .build();
+
+                Engine::Search search( *board, goArgs );
+
+                auto startTime = std::chrono::steady_clock::now();
+                Engine::Search::start( &engine, &search, &search.stats, [&move] ( const Move& bestMove, const Move& )
+                {
+                    move = bestMove;
+                } );
+                long long used = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime ).count();
+
+                moveCount++;
+                totalUsed += used;
+                totalShare += static_cast<double>( used ) / clock;
+                if ( used > maxUsed )
+                {
+                    maxUsed = used;
+                }
+
+                clock -= used;
+                if ( clock < 0 )
+                {
+                    timeLosses++;
+                    result = white ? "white lost on time" : "black lost on time";
+                    break;
+                }
+                clock += increment;
+            }
+
+            if ( move.isNullMove() )
+            {
+                result = "no legal moves";
+                break;
+            }
+
+            board->applyMove( move );
+        }
+
+        engine.infoBroadcast( "string", "selfplay game %u plies %u result %s clocks %lld %lld", game, ply, result, clocks[ 0 ], clocks[ 1 ] );
+
+        delete board;
+    }
+
+    engine.infoBroadcast( "string", "selfplay games %u time %u increment %u timelosses %u moves %llu avgtime %lld maxtime %lld avgshare %.1f%%",
+                          games,
+                          time,
+                          increment,
+                          timeLosses,
+                          moveCount,
+                          moveCount == 0 ? 0 : totalUsed / static_cast<long long>( moveCount ),
+                          maxUsed,
+                          moveCount == 0 ? 0.0 : 100 * totalShare / moveCount );
+}
+
+void Bench::threadScaling( Engine& engine, const std::string& filename, unsigned int depth )
+{
+    static const unsigned int THREAD_COUNTS[] = { 1, 2, 4, 8, 16 };
+
+    // Default depth for any position in the script without a 'go depth'
+    static const unsigned int DEFAULT_DEPTH = 5;
+
+    std::ifstream infile = std::ifstream( filename );
+    if ( !infile.is_open() )
+    {
+        fprintf( stderr, "Cannot read input file: %s\n", filename.c_str() );
+        return;
+    }
+
+    std::vector<std::pair<std::string, unsigned int>> positions;
+
+    std::string line;
+    while ( std::getline( infile, line ) )
+    {
+        if ( line.starts_with( "position fen " ) )
+        {
+            positions.push_back( std::pair<std::string, unsigned int>( line.substr( 13 ), depth == 0 ? DEFAULT_DEPTH : depth ) );
+        }
+        else if ( line.starts_with( "go depth " ) && depth == 0 && !positions.empty() )
+        {
+            positions.back().second = atoi( line.substr( 9 ).c_str() );
+        }
+    }
+
+    if ( positions.empty() )
+    {
+        fprintf( stderr, "No positions found in: %s\n", filename.c_str() );
+        return;
+    }
+
+    long long baseline = 0;
+
+    for ( const unsigned int threads : THREAD_COUNTS )
+    {
+        long long elapsed = 0;
+        size_t nodes = 0;
+
+        for ( std::vector<std::pair<std::string, unsigned int>>::const_iterator it = positions.cbegin(); it != positions.cend(); it++ )
+        {
+            // Start each search from an empty table so that every thread count does the same work
+            Engine::ucinewgameCommand( engine, "" );
+
+            Board* board = Board::createBoard( ( *it ).first );
+            GoArguments goArgs = GoArguments::Builder().setDepth( ( *it ).second ).build();
+
+            Engine::Search search( *board, goArgs, threads );
+
+            auto startTime = std::chrono::steady_clock::now();
+            Engine::Search::start( &engine, &search, &search.stats, [] ( const Move&, const Move& )
+            {
+            } );
+            elapsed += std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime ).count();
+
+            nodes += search.stats.nodesTotal;
+
+            delete board;
+        }
+
+        if ( threads == 1 )
+        {
+            baseline = elapsed;
+        }
+
+        engine.infoBroadcast( "string", "smp threads %u positions %zu time %lld nodes %zu nps %llu speedup %.2f",
+                              threads,
+                              positions.size(),
+                              elapsed,
+                              nodes,
+                              elapsed == 0 ? 0 : static_cast<unsigned long long>( nodes ) * 1000 / elapsed,
+                              elapsed == 0 ? 0.0 : static_cast<double>( baseline ) / elapsed );
+    }
+}
+
+void Bench::goLatency( const Engine& engine, unsigned int count )
+{
+    Board* board = Board::createBoard( Fen::startingPosition );
+    GoArguments goArgs = GoArguments::Builder().setDepth( 1 ).build();
+
+    std::chrono::steady_clock::time_point bestMoveTime;
+    auto bestMoveHandler = [&bestMoveTime] ( const Move&, const Move& )
+    {
+        bestMoveTime = std::chrono::steady_clock::now();
+    };
+
+    long long pooled = 0;
+    for ( unsigned int loop = 0; loop < count; loop++ )
+    {
+        Engine::Search search( *board, goArgs );
+
+        auto startTime = std::chrono::steady_clock::now();
+        search.run( &engine, bestMoveHandler );
+        search.wait();
+
+        pooled += std::chrono::duration_cast<std::chrono::nanoseconds>( bestMoveTime - startTime ).count();
+    }
+
+    long long threaded = 0;
+    for ( unsigned int loop = 0; loop < count; loop++ )
+    {
+        Engine::Search search( *board, goArgs );
+
+        auto startTime = std::chrono::steady_clock::now();
+        std::thread thread( &Engine::Search::start, &engine, &search, &search.stats, bestMoveHandler );
+        thread.join();
+
+        threaded += std::chrono::duration_cast<std::chrono::nanoseconds>( bestMoveTime - startTime ).count();
+    }
+
+    engine.infoBroadcast( "string", "go latency searches %u pooled %.1f us newthread %.1f us",
+                          count,
+                          pooled / 1000.0 / count,
+                          threaded / 1000.0 / count );
+
+    delete board;
+}
+
+const char* Bench::POSITIONS[ 10 ] =
+{
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1",
+    "8/5k2/8/8/8/8/1Q6/4K3 w - - 0 1",
+};
+
+void Bench::fixedDepth( Engine& engine, unsigned int depth )
+{
+    long long elapsed = 0;
+    size_t nodes = 0;
+    size_t pawnHashProbes = 0;
+    size_t pawnHashHits = 0;
+    unsigned int position = 0;
+
+    for ( const char* fen : POSITIONS )
+    {
+        position++;
+
+        // Start each search from an empty table so that each position is measured on its own
+        Engine::ucinewgameCommand( engine, "" );
+
+        Board* board = Board::createBoard( fen );
+        GoArguments goArgs = GoArguments::Builder().setDepth( depth ).build();
+
+        Engine::Search search( *board, goArgs );
+
+        Move move = Move::nullMove;
+
+        auto startTime = std::chrono::steady_clock::now();
+        Engine::Search::start( &engine, &search, &search.stats, [&move] ( const Move& bestMove, const Move& )
+        {
+            move = bestMove;
+        } );
+        const long long used = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime ).count();
+
+        elapsed += used;
+        nodes += search.stats.nodesTotal;
+        pawnHashProbes += search.stats.pawnHashProbes;
+        pawnHashHits += search.stats.pawnHashHits;
+
+        engine.infoBroadcast( "string", "bench position %u nodes %zu time %lld bestmove %s", position, search.stats.nodesTotal.load(), used, move.toString().c_str() );
+
+        delete board;
+    }
+
+    engine.infoBroadcast( "string", "bench depth %u positions %u nodes %zu time %lld nps %llu pawnhash %.2f%%",
+                          depth,
+                          position,
+                          nodes,
+                          elapsed,
+                          elapsed == 0 ? 0 : static_cast<unsigned long long>( nodes ) * 1000 / elapsed,
+                          pawnHashProbes == 0 ? 0.0 : 100.0 * pawnHashHits / pawnHashProbes );
+}
+
+void Bench::attackMaps( const Engine& engine, unsigned int iterations )
+{
+    // The fixed positions, and each position one move on from them, for some variety
+    std::vector<Board*> boards;
+    for ( const char* fen : POSITIONS )
+    {
+        Board* board = Board::createBoard( fen );
+        boards.push_back( board );
+
+        MoveList moves;
+        board->getMoves( moves );
+        for ( const Move& move : moves )
+        {
+            Board* child = new Board( *board );
+            child->applyMove( move );
+            boards.push_back( child );
+        }
+    }
+
+    size_t mismatches = 0;
+    for ( const Board* board : boards )
+    {
+        for ( bool white : { true, false } )
+        {
+            if ( board->getAttackMap( white ) != board->getAttackMapBySquare( white ) )
+            {
+                mismatches++;
+            }
+        }
+    }
+
+    // Fold every map into a total that is reported, so that neither loop can be optimised away
+    unsigned long long total = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+    for ( unsigned int loop = 0; loop < iterations; loop++ )
+    {
+        for ( const Board* board : boards )
+        {
+            board->computeAttackMaps();
+            total += board->getAttackMap( true ) ^ board->getAttackMap( false );
+        }
+    }
+    const long long setWise = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - startTime ).count();
+
+    startTime = std::chrono::steady_clock::now();
+    for ( unsigned int loop = 0; loop < iterations; loop++ )
+    {
+        for ( const Board* board : boards )
+        {
+            total += board->getAttackMapBySquare( true ) ^ board->getAttackMapBySquare( false );
+        }
+    }
+    const long long bySquare = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - startTime ).count();
+
+    const double count = static_cast<double>( iterations ) * boards.size();
+
+    engine.infoBroadcast( "string", "bench attacks positions %zu setwise %.1f ns bysquare %.1f ns speedup %.1fx mismatches %zu checksum %llx",
+                          boards.size(),
+                          setWise / count,
+                          bySquare / count,
+                          setWise == 0 ? 0.0 : static_cast<double>( bySquare ) / setWise,
+                          mismatches,
+                          total );
+
+    for ( Board* board : boards )
+    {
+        delete board;
+    }
+}
+
+void Bench::networkEvaluation( Engine& engine, unsigned int depth )
+{
+    static const unsigned int POSITION_COUNT = sizeof( POSITIONS ) / sizeof( POSITIONS[ 0 ] );
+
+    // Put the option back as it was afterwards
+    const bool wasNetworkEvaluation = engine.isNetworkEvaluation();
+
+    // Hand-written first, then the network
+    long long elapsed[ 2 ] = { 0, 0 };
+    size_t nodes[ 2 ] = { 0, 0 };
+    short scores[ 2 ][ POSITION_COUNT ];
+    Move moves[ 2 ][ POSITION_COUNT ];
+
+    std::vector<Nnue::Accumulator> accumulators( 1 );
+
+    for ( unsigned int network = 0; network < 2; network++ )
+    {
+        Engine::setoptionCommand( engine, network ? "name UseNNUE value true" : "name UseNNUE value false" );
+
+        for ( unsigned int position = 0; position < POSITION_COUNT; position++ )
+        {
+            // Start each search from an empty table so that each position is measured on its own
+            Engine::ucinewgameCommand( engine, "" );
+
+            Board* board = Board::createBoard( POSITIONS[ position ] );
+
+            // The static score, from the side to move's point of view
+            board->setAccumulators( network ? accumulators.data() : nullptr, accumulators.data() + accumulators.size() );
+            scores[ network ][ position ] = board->scorePosition( board->whiteToPlay() );
+            board->setAccumulators( nullptr, nullptr );
+
+            GoArguments goArgs = GoArguments::Builder().setDepth( depth ).build();
+            Engine::Search search( *board, goArgs );
+
+            Move& move = moves[ network ][ position ];
+            move = Move::nullMove;
+
+            auto startTime = std::chrono::steady_clock::now();
+            Engine::Search::start( &engine, &search, &search.stats, [&move] ( const Move& bestMove, const Move& )
+            {
+                move = bestMove;
+            } );
+            elapsed[ network ] += std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime ).count();
+            nodes[ network ] += search.stats.nodesTotal;
+
+            delete board;
+        }
+    }
+
+    Engine::setoptionCommand( engine, wasNetworkEvaluation ? "name UseNNUE value true" : "name UseNNUE value false" );
+
+    unsigned int agreed = 0;
+    for ( unsigned int position = 0; position < POSITION_COUNT; position++ )
+    {
+        if ( moves[ 0 ][ position ] == moves[ 1 ][ position ] )
+        {
+            agreed++;
+        }
+
+        engine.infoBroadcast( "string", "bench position %u classical score %d bestmove %s network score %d bestmove %s",
+                              position + 1,
+                              scores[ 0 ][ position ],
+                              moves[ 0 ][ position ].toString().c_str(),
+                              scores[ 1 ][ position ],
+                              moves[ 1 ][ position ].toString().c_str() );
+    }
+
+    engine.infoBroadcast( "string", "bench nnue depth %u classical nodes %zu nps %llu network nodes %zu nps %llu agreed %u/%u",
+                          depth,
+                          nodes[ 0 ],
+                          elapsed[ 0 ] == 0 ? 0 : static_cast<unsigned long long>( nodes[ 0 ] ) * 1000 / elapsed[ 0 ],
+                          nodes[ 1 ],
+                          elapsed[ 1 ] == 0 ? 0 : static_cast<unsigned long long>( nodes[ 1 ] ) * 1000 / elapsed[ 1 ],
+                          agreed,
+                          POSITION_COUNT );
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+
+#include "Engine.h"
+
+class Bench
+{
+private:
+    // Positions covering the opening, middlegame and endgame, for the benches that want a fixed set
+    static const char* POSITIONS[ 10 ];
+
+public:
+    /// <summary>
+    /// Hammer a small transposition table from several threads at once, storing and probing a handful of keys
+    /// whose content can be verified. Reports how many torn reads were detected (and discarded) and how many
+    /// corrupt entries got through - which should always be none
+    /// </summary>
+    /// <param name="engine">the engine, for reporting</param>
+    /// <param name="threadCount">number of threads to run</param>
+    /// <param name="iterations">number of table operations per thread</param>
+    static void transpositionTableStress( const Engine& engine, unsigned int threadCount, unsigned int iterations );
+
+    /// <summary>
+    /// Play the engine against itself on a clock, as a GUI would - time used is deducted from the side to move and the
+    /// increment added back. The first move of each side is random so that the games differ. Reports the games lost on
+    /// time and the average time used per move, both in milliseconds and as a share of the clock
+    /// </summary>
+    /// <param name="engine">the engine, to search with and for reporting</param>
+    /// <param name="games">number of games to play</param>
+    /// <param name="time">starting clock for each side, in milliseconds</param>
+    /// <param name="increment">increment per move, in milliseconds</param>
+    static void selfPlayTiming( const Engine& engine, unsigned int games, unsigned int time, unsigned int increment );
+
+    /// <summary>
+    /// Time searches to a fixed depth with 1, 2, 4, 8 and 16 threads. Positions are the 'position fen' lines of a
+    /// UCI script, each searched to the depth of the 'go depth' that follows it unless a depth is given. The hash is
+    /// cleared before each search. Reports total time and nodes, and speedup over one thread, for each thread count
+    /// </summary>
+    /// <param name="engine">the engine, to search with and for reporting</param>
+    /// <param name="filename">the script to take positions from</param>
+    /// <param name="depth">the depth to search to, or zero to use the depths from the script</param>
+    static void threadScaling( Engine& engine, const std::string& filename, unsigned int depth );
+
+    /// <summary>
+    /// Issue many 'go depth 1' searches from the starting position, one after another, and time each from the go to
+    /// the best move - which follows straight on from the first info at that depth. Runs them on the search thread pool,
+    /// as a go command does, and then again on a new thread for each search to compare
+    /// </summary>
+    /// <param name="engine">the engine, to search with and for reporting</param>
+    /// <param name="count">number of searches to run each way</param>
+    static void goLatency( const Engine& engine, unsigned int count );
+
+    /// <summary>
+    /// Search a fixed set of positions, covering the opening, middlegame and endgame, to a fixed depth on one thread,
+    /// clearing the hash before each. Reports the nodes and best move for each position, then the totals - so that a
+    /// change to the search, or a selective search option turned off, can be measured by its effect on nodes and time
+    /// to the same depth
+    /// </summary>
+    /// <param name="engine">the engine, to search with and for reporting</param>
+    /// <param name="depth">the depth to search each position to</param>
+    static void fixedDepth( Engine& engine, unsigned int depth );
+
+    /// <summary>
+    /// Time working out both sides' attack maps, set-wise and square by square, over the fixed set of positions and every
+    /// position a move on from them. Reports the time per position each way, and how many maps differ - which should
+    /// always be none
+    /// </summary>
+    /// <param name="engine">the engine, for reporting</param>
+    /// <param name="iterations">number of times to work out the maps for each position, each way</param>
+    static void attackMaps( const Engine& engine, unsigned int iterations );
+
+    /// <summary>
+    /// Search the fixed set of positions to a fixed depth on one thread, as fixedDepth does, once with the hand-written
+    /// evaluation and once with the network. Reports each position's static score and best move under each, then the
+    /// nodes and speed of each and how often they agree on the move. Needs a network to be loaded
+    /// </summary>
+    /// <param name="engine">the engine, to search with and for reporting</param>
+    /// <param name="depth">the depth to search each position to</param>
+    static void networkEvaluation( Engine& engine, unsigned int depth );
+};
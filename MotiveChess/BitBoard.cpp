@@ -1,5 +1,6 @@
 #include "BitBoard.h"
 
+#include <bit>
 #include <bitset>
 #include <iostream>
 
@@ -17,6 +18,15 @@ unsigned long long BitBoard::southWestMoves[ 64 ];
 unsigned long long BitBoard::northWestMoves[ 64 ];
 unsigned long long BitBoard::southEastMoves[ 64 ];
 
+BitBoard::Magic BitBoard::bishopMagics[ 64 ];
+BitBoard::Magic BitBoard::rookMagics[ 64 ];
+
+unsigned long long BitBoard::bishopAttackTable[ 5248 ];
+unsigned long long BitBoard::rookAttackTable[ 102400 ];
+
+unsigned long long BitBoard::betweenMasks[ 64 ][ 64 ];
+unsigned long long BitBoard::lineMasks[ 64 ][ 64 ];
+
 unsigned long long BitBoard::pawnMovesNormalWhite[ 64 ];
 unsigned long long BitBoard::pawnMovesNormalBlack[ 64 ];
 unsigned long long BitBoard::pawnMovesExtendedWhite[ 64 ];
@@ -196,6 +206,193 @@ void BitBoard::initialize()
             kingMoves[ square ] |= 1ull << ( square + 1 );
         }
     }
+
+    // Sliders - one lookup per piece, built on top of the ray masks above
+    initializeMagics( bishopMagics, bishopAttackTable, true );
+    initializeMagics( rookMagics, rookAttackTable, false );
+
+    // Lines and the squares between - used for pins and blocking checks
+    for ( unsigned short from = 0; from < 64; from++ )
+    {
+        for ( unsigned short to = 0; to < 64; to++ )
+        {
+            const unsigned long long fromBit = 1ull << from;
+            const unsigned long long toBit = 1ull << to;
+
+            betweenMasks[ from ][ to ] = 0;
+            lineMasks[ from ][ to ] = 0;
+
+            if ( from == to )
+            {
+                continue;
+            }
+
+            if ( getBishopAttacks( from, 0 ) & toBit )
+            {
+                betweenMasks[ from ][ to ] = getBishopAttacks( from, toBit ) & getBishopAttacks( to, fromBit );
+                lineMasks[ from ][ to ] = ( getBishopAttacks( from, 0 ) & getBishopAttacks( to, 0 ) ) | fromBit | toBit;
+            }
+            else if ( getRookAttacks( from, 0 ) & toBit )
+            {
+                betweenMasks[ from ][ to ] = getRookAttacks( from, toBit ) & getRookAttacks( to, fromBit );
+                lineMasks[ from ][ to ] = ( getRookAttacks( from, 0 ) & getRookAttacks( to, 0 ) ) | fromBit | toBit;
+            }
+        }
+    }
+}
+
+unsigned long long BitBoard::slidingAttacks( const unsigned short square, const unsigned long long occupancy, bool diagonal )
+{
+    const unsigned long long* rays[ 4 ];
+    if ( diagonal )
+    {
+        rays[ 0 ] = northEastMoves;
+        rays[ 1 ] = northWestMoves;
+        rays[ 2 ] = southEastMoves;
+        rays[ 3 ] = southWestMoves;
+    }
+    else
+    {
+        rays[ 0 ] = northMoves;
+        rays[ 1 ] = southMoves;
+        rays[ 2 ] = eastMoves;
+        rays[ 3 ] = westMoves;
+    }
+
+    unsigned long long attacks = 0;
+    for ( unsigned short direction = 0; direction < 4; direction++ )
+    {
+        const unsigned long long ray = rays[ direction ][ square ];
+        const unsigned long long blockers = ray & occupancy;
+
+        attacks |= ray;
+
+        if ( blockers )
+        {
+            // The nearest blocker is the lowest bit for rays heading up the board, the highest for those heading down.
+            // Everything beyond it, which is the same ray cast from the blocker, is not attacked
+            const bool ascending = ( ray >> square ) != 0;
+            const unsigned short blocker = ascending ? std::countr_zero( blockers ) : 63 - std::countl_zero( blockers );
+
+            attacks &= ~rays[ direction ][ blocker ];
+        }
+    }
+
+    return attacks;
+}
+
+void BitBoard::initializeMagics( Magic* magics, unsigned long long* table, bool diagonal )
+{
+    const unsigned long long* rays[ 4 ];
+    if ( diagonal )
+    {
+        rays[ 0 ] = northEastMoves;
+        rays[ 1 ] = northWestMoves;
+        rays[ 2 ] = southEastMoves;
+        rays[ 3 ] = southWestMoves;
+    }
+    else
+    {
+        rays[ 0 ] = northMoves;
+        rays[ 1 ] = southMoves;
+        rays[ 2 ] = eastMoves;
+        rays[ 3 ] = westMoves;
+    }
+
+    unsigned long long occupancies[ 4096 ];
+    unsigned long long references[ 4096 ];
+
+#ifndef USE_PEXT
+    // Fixed seed so the magics (and any problems with them) are the same from run to run
+    unsigned long long seed = 0x45a1b3c9d7e5f201ull;
+    auto random = [&seed] () -> unsigned long long
+    {
+        seed ^= seed >> 12;
+        seed ^= seed << 25;
+        seed ^= seed >> 27;
+        return seed * 0x2545f4914f6cdd1dull;
+    };
+
+    // Shared by every square's search, so the epoch carries on rising and the slots never need clearing
+    unsigned int epochs[ 4096 ] = { 0 };
+    unsigned int epoch = 0;
+#endif
+
+    unsigned long long* attacks = table;
+    for ( unsigned short square = 0; square < 64; square++ )
+    {
+        Magic& magic = magics[ square ];
+
+        // Only the squares along each ray, apart from the last one, can block anything
+        magic.mask = 0;
+        for ( unsigned short direction = 0; direction < 4; direction++ )
+        {
+            const unsigned long long ray = rays[ direction ][ square ];
+            if ( ray )
+            {
+                const bool ascending = ( ray >> square ) != 0;
+                const unsigned short last = ascending ? 63 - std::countl_zero( ray ) : std::countr_zero( ray );
+
+                magic.mask |= ray & ~( 1ull << last );
+            }
+        }
+
+        const unsigned short bits = std::popcount( magic.mask );
+        const unsigned int size = 1u << bits;
+
+        magic.shift = 64 - bits;
+        magic.attacks = attacks;
+        attacks += size;
+
+        // Enumerate every subset of the mask (the carry-rippler trick) with the attacks it results in
+        unsigned long long occupancy = 0;
+        for ( unsigned int loop = 0; loop < size; loop++ )
+        {
+            occupancies[ loop ] = occupancy;
+            references[ loop ] = slidingAttacks( square, occupancy, diagonal );
+
+            occupancy = ( occupancy - magic.mask ) & magic.mask;
+        }
+
+#ifdef USE_PEXT
+        magic.magic = 0;
+
+        for ( unsigned int loop = 0; loop < size; loop++ )
+        {
+            magic.attacks[ magic.index( occupancies[ loop ] ) ] = references[ loop ];
+        }
+#else
+        // Try sparse random numbers until one maps every subset to a slot without a destructive collision
+        // Each attempt gets a new epoch so the slots used by earlier attempts don't need clearing
+        for ( bool found = false; !found; )
+        {
+            do
+            {
+                magic.magic = random() & random() & random();
+            }
+            while ( std::popcount( ( magic.mask * magic.magic ) >> 56 ) < 6 );
+
+            epoch++;
+            found = true;
+
+            for ( unsigned int loop = 0; loop < size; loop++ )
+            {
+                const unsigned long index = magic.index( occupancies[ loop ] );
+
+                if ( epochs[ index ] < epoch )
+                {
+                    epochs[ index ] = epoch;
+                    magic.attacks[ index ] = references[ loop ];
+                }
+                else if ( magic.attacks[ index ] != references[ loop ] )
+                {
+                    found = false;
+                    break;
+                }
+            }
+        }
+#endif
+    }
 }
 
 void BitBoard::dumpBitBoard( unsigned long long mask, const char* title )
@@ -1,10 +1,44 @@
 #pragma once
 
+#ifdef USE_PEXT
+#include <immintrin.h>
+#endif
+
 class BitBoard
 {
 private:
     static unsigned short RANKFILE_MASK;
 
+    /// <summary>
+    /// Everything needed to look up the attacks of a slider on one square for any board occupancy.
+    /// The relevant occupancy (the squares along the rays, excluding the board edges) is turned into an
+    /// index either with PEXT or by the multiply-shift magic, and that indexes this square's portion of a shared table
+    /// </summary>
+    class Magic
+    {
+    public:
+        unsigned long long mask;
+        unsigned long long magic;
+        unsigned long long* attacks;
+        unsigned short shift;
+
+        inline unsigned long index( const unsigned long long occupancy ) const
+        {
+#ifdef USE_PEXT
+            return static_cast<unsigned long>( _pext_u64( occupancy, mask ) );
+#else
+            return static_cast<unsigned long>( ( ( occupancy & mask ) * magic ) >> shift );
+#endif
+        }
+    };
+
+    static Magic bishopMagics[ 64 ];
+    static Magic rookMagics[ 64 ];
+
+    // Shared storage for all squares - sized for the sum over all squares of 2^(relevant bits)
+    static unsigned long long bishopAttackTable[ 5248 ];
+    static unsigned long long rookAttackTable[ 102400 ];
+
     // Masks for sliders
     static unsigned long long northMoves[ 64 ];
     static unsigned long long southMoves[ 64 ];
@@ -18,6 +52,10 @@ private:
     static unsigned long long northWestMoves[ 64 ];
     static unsigned long long southWestMoves[ 64 ];
 
+    // Squares strictly between two squares on a shared rank, file or diagonal, and the whole line through them
+    static unsigned long long betweenMasks[ 64 ][ 64 ];
+    static unsigned long long lineMasks[ 64 ][ 64 ];
+
     // Masks for non-sliders
     static unsigned long long pawnMovesNormalWhite[ 64 ];
     static unsigned long long pawnMovesNormalBlack[ 64 ];
@@ -197,6 +235,88 @@ private:
         return mask;
     }
 
+    /// <summary>
+    /// Work out slider attacks the slow way, by walking each ray until it hits something. Used to fill the attack tables
+    /// </summary>
+    /// <param name="square">the slider's square</param>
+    /// <param name="occupancy">occupied squares</param>
+    /// <param name="diagonal">true for bishop rays, false for rook rays</param>
+    /// <returns>the attacked squares, including any occupied squares at the end of each ray</returns>
+    static unsigned long long slidingAttacks( const unsigned short square, const unsigned long long occupancy, bool diagonal );
+
+    /// <summary>
+    /// Fill in the magic details and attack table entries for sliders of one type
+    /// </summary>
+    /// <param name="magics">per-square magic details to populate</param>
+    /// <param name="table">shared attack table to populate</param>
+    /// <param name="diagonal">true for bishops, false for rooks</param>
+    static void initializeMagics( Magic* magics, unsigned long long* table, bool diagonal );
+
+    // Files either side of the board - a set shifted a file across must lose what wrapped round from the other edge
+    static const unsigned long long FILE_A = 0x0101010101010101ull;
+    static const unsigned long long FILE_H = 0x8080808080808080ull;
+
+    /// <summary>
+    /// Shift a set of squares by a step - a positive step towards h8, a negative one towards a1 - without wrapping
+    /// </summary>
+    template <int STEP>
+    inline static unsigned long long shiftSet( const unsigned long long squares )
+    {
+        if constexpr ( STEP > 0 )
+        {
+            return ( squares << STEP ) & wrapMask<STEP>();
+        }
+        else
+        {
+            return ( squares >> -STEP ) & wrapMask<STEP>();
+        }
+    }
+
+    /// <summary>
+    /// Squares a step can land on without having wrapped from one edge of the board to the other
+    /// </summary>
+    template <int STEP>
+    inline static constexpr unsigned long long wrapMask()
+    {
+        // Steps of 1, 9 and -7 go towards the h-file, and -1, -9 and 7 towards the a-file
+        return ( STEP == 1 || STEP == 9 || STEP == -7 ) ? ~FILE_A : ( STEP == -1 || STEP == -9 || STEP == 7 ) ? ~FILE_H : ~0ull;
+    }
+
+    /// <summary>
+    /// Kogge-Stone occluded fill - every slider in the set slid as far as it can in one direction, all at once, in three
+    /// doubling steps and without branching
+    /// </summary>
+    /// <param name="sliders">the sliders</param>
+    /// <param name="emptySquares">squares the sliders can pass through</param>
+    /// <returns>the squares attacked in that direction, including the first occupied square on each ray</returns>
+    template <int STEP>
+    inline static unsigned long long slideSet( unsigned long long sliders, unsigned long long emptySquares )
+    {
+        // Wrapping is dealt with by taking the squares it would land on out of the propagator, once, up front
+        emptySquares &= wrapMask<STEP>();
+
+        sliders |= emptySquares & shiftRaw<STEP>( sliders );
+        emptySquares &= shiftRaw<STEP>( emptySquares );
+        sliders |= emptySquares & shiftRaw<2 * STEP>( sliders );
+        emptySquares &= shiftRaw<2 * STEP>( emptySquares );
+        sliders |= emptySquares & shiftRaw<4 * STEP>( sliders );
+
+        return shiftSet<STEP>( sliders );
+    }
+
+    template <int STEP>
+    inline static unsigned long long shiftRaw( const unsigned long long squares )
+    {
+        if constexpr ( STEP > 0 )
+        {
+            return squares << STEP;
+        }
+        else
+        {
+            return squares >> -STEP;
+        }
+    }
+
     inline static unsigned short file( const unsigned short square )
     {
         return square & RANKFILE_MASK;
@@ -292,6 +412,94 @@ public:
         return southWestMoves[ index ];
     }
 
+    /// <summary>
+    /// All squares attacked by a bishop on this square, given the occupied squares. This includes
+    /// the first occupied square on each diagonal, whoever it belongs to
+    /// </summary>
+    inline static unsigned long long getBishopAttacks( const unsigned long index, const unsigned long long occupancy )
+    {
+        const Magic& magic = bishopMagics[ index ];
+        return magic.attacks[ magic.index( occupancy ) ];
+    }
+
+    /// <summary>
+    /// All squares attacked by a rook on this square, given the occupied squares. This includes
+    /// the first occupied square on each rank and file, whoever it belongs to
+    /// </summary>
+    inline static unsigned long long getRookAttacks( const unsigned long index, const unsigned long long occupancy )
+    {
+        const Magic& magic = rookMagics[ index ];
+        return magic.attacks[ magic.index( occupancy ) ];
+    }
+
+    inline static unsigned long long getQueenAttacks( const unsigned long index, const unsigned long long occupancy )
+    {
+        return getBishopAttacks( index, occupancy ) | getRookAttacks( index, occupancy );
+    }
+
+    // Set-wise attack generators. These take a set of pieces and return every square any of them attacks, without
+    // looping over the pieces - so a whole side's attacks come from a handful of shifts, rather than a lookup per piece
+
+    inline static unsigned long long getWhitePawnAttackSet( const unsigned long long pawns )
+    {
+        return shiftSet<7>( pawns ) | shiftSet<9>( pawns );
+    }
+
+    inline static unsigned long long getBlackPawnAttackSet( const unsigned long long pawns )
+    {
+        return shiftSet<-9>( pawns ) | shiftSet<-7>( pawns );
+    }
+
+    inline static unsigned long long getKnightAttackSet( const unsigned long long knights )
+    {
+        // One file across and two ranks, or two files across and one rank
+        const unsigned long long oneFile = shiftSet<1>( knights ) | shiftSet<-1>( knights );
+        const unsigned long long twoFiles = ( ( knights << 2 ) & ~( FILE_A | ( FILE_A << 1 ) ) ) | ( ( knights >> 2 ) & ~( FILE_H | ( FILE_H >> 1 ) ) );
+
+        return ( oneFile << 16 ) | ( oneFile >> 16 ) | ( twoFiles << 8 ) | ( twoFiles >> 8 );
+    }
+
+    inline static unsigned long long getKingAttackSet( const unsigned long long kings )
+    {
+        const unsigned long long sideways = shiftSet<1>( kings ) | shiftSet<-1>( kings );
+        const unsigned long long row = kings | sideways;
+
+        return sideways | ( row << 8 ) | ( row >> 8 );
+    }
+
+    /// <summary>
+    /// All squares attacked along diagonals by a set of bishops and queens. Like getBishopAttacks, this includes
+    /// the first occupied square on each ray, whoever it belongs to
+    /// </summary>
+    inline static unsigned long long getDiagonalAttackSet( const unsigned long long sliders, const unsigned long long emptySquares )
+    {
+        return slideSet<9>( sliders, emptySquares ) | slideSet<7>( sliders, emptySquares ) | slideSet<-7>( sliders, emptySquares ) | slideSet<-9>( sliders, emptySquares );
+    }
+
+    /// <summary>
+    /// All squares attacked along ranks and files by a set of rooks and queens, as for getDiagonalAttackSet
+    /// </summary>
+    inline static unsigned long long getOrthogonalAttackSet( const unsigned long long sliders, const unsigned long long emptySquares )
+    {
+        return slideSet<8>( sliders, emptySquares ) | slideSet<-8>( sliders, emptySquares ) | slideSet<1>( sliders, emptySquares ) | slideSet<-1>( sliders, emptySquares );
+    }
+
+    /// <summary>
+    /// The squares strictly between two squares that share a rank, file or diagonal. Empty if they don't
+    /// </summary>
+    inline static unsigned long long getBetweenMask( const unsigned long from, const unsigned long to )
+    {
+        return betweenMasks[ from ][ to ];
+    }
+
+    /// <summary>
+    /// The full edge to edge line through two squares that share a rank, file or diagonal. Empty if they don't
+    /// </summary>
+    inline static unsigned long long getLineMask( const unsigned long from, const unsigned long to )
+    {
+        return lineMasks[ from ][ to ];
+    }
+
     inline static unsigned long long getWhiteKingsideCastlingMask()
     {
         return whiteKingsideCastlingMask;
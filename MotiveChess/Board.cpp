@@ -1,6 +1,7 @@
 #include "Board.h"
 
 #include <algorithm>
+#include <bit>
 #include <bitset>
 #include <iostream>
 #include <sstream>
@@ -22,7 +23,223 @@ const unsigned short Board::ROOK = 3;
 const unsigned short Board::QUEEN = 4;
 const unsigned short Board::KING = 5;
 
-bool Board::getMoves( std::vector<Move>& moves )
+const short Board::PIECE_VALUES[ 6 ] = { 100, 310, 320, 500, 900, 10000 };
+
+bool Board::getMoves( MoveList& moves ) const
+{
+    return getLegalMoves<Generation::ALL>( moves );
+}
+
+bool Board::getQuiescentMoves( MoveList& moves ) const
+{
+    return getLegalMoves<Generation::QUIESCENT>( moves );
+}
+
+bool Board::getCaptures( MoveList& moves ) const
+{
+    return getLegalMoves<Generation::CAPTURES>( moves );
+}
+
+bool Board::getQuietMoves( MoveList& moves ) const
+{
+    return getLegalMoves<Generation::QUIETS>( moves );
+}
+
+bool Board::validateMove( Move& move ) const
+{
+    const unsigned short bitboardPieceIndex = whiteToMove ? WHITE : BLACK;
+    const unsigned long long ownPieces = bitboards[ bitboardPieceIndex + PAWN ] | bitboards[ bitboardPieceIndex + KNIGHT ] | bitboards[ bitboardPieceIndex + BISHOP ] | bitboards[ bitboardPieceIndex + ROOK ] | bitboards[ bitboardPieceIndex + QUEEN ] | bitboards[ bitboardPieceIndex + KING ];
+
+    if ( move.isNullMove() || !( ownPieces & ( 1ull << move.getFrom() ) ) )
+    {
+        return false;
+    }
+
+    bool found = false;
+
+    // Only generate moves to the one square, and stop as soon as the move turns up
+    auto consumer = [&] ( const Move& candidate ) -> bool
+    {
+        if ( candidate.isEquivalent( move ) )
+        {
+            move = candidate;
+            found = true;
+
+            return false;
+        }
+
+        return true;
+    };
+
+    const unsigned long long toBit = 1ull << move.getTo();
+    if ( whiteToMove )
+    {
+        getLegalMoves<true, Generation::ALL>( consumer, toBit );
+    }
+    else
+    {
+        getLegalMoves<false, Generation::ALL>( consumer, toBit );
+    }
+
+    return found;
+}
+
+template <Board::Generation GENERATION>
+bool Board::getLegalMoves( MoveList& moves ) const
+{
+    auto consumer = [&moves] ( const Move& move ) -> bool
+    {
+        moves.push_back( move );
+
+        return true;
+    };
+
+    return whiteToMove ? getLegalMoves<true, GENERATION>( consumer, ~0ull ) : getLegalMoves<false, GENERATION>( consumer, ~0ull );
+}
+
+bool Board::isInCheck() const
+{
+    const unsigned short bitboardPieceIndex = whiteToMove ? WHITE : BLACK;
+    const unsigned short opponentPieceIndex = whiteToMove ? BLACK : WHITE;
+
+    const unsigned long long opponentPieces = bitboards[ opponentPieceIndex + PAWN ] | bitboards[ opponentPieceIndex + KNIGHT ] | bitboards[ opponentPieceIndex + BISHOP ] | bitboards[ opponentPieceIndex + ROOK ] | bitboards[ opponentPieceIndex + QUEEN ] | bitboards[ opponentPieceIndex + KING ];
+
+    return getAttackers( squareFromBit( bitboards[ bitboardPieceIndex + KING ] ), ~bitboards[ EMPTY ] ) & opponentPieces;
+}
+
+template <bool WHITE_TO_MOVE, Board::Generation GENERATION, typename Consumer>
+bool Board::getLegalMoves( Consumer& consumer, const unsigned long long& targetSquares ) const
+{
+    const unsigned short bitboardPieceIndex = WHITE_TO_MOVE ? WHITE : BLACK;
+    const unsigned short opponentPieceIndex = WHITE_TO_MOVE ? BLACK : WHITE;
+
+    const unsigned long long occupiedSquares = ~bitboards[ EMPTY ];
+    const unsigned long long opponentPieces = bitboards[ opponentPieceIndex + PAWN ] | bitboards[ opponentPieceIndex + KNIGHT ] | bitboards[ opponentPieceIndex + BISHOP ] | bitboards[ opponentPieceIndex + ROOK ] | bitboards[ opponentPieceIndex + QUEEN ] | bitboards[ opponentPieceIndex + KING ];
+
+    unsigned long kingIndex = 0;
+    scanForward( &kingIndex, bitboards[ bitboardPieceIndex + KING ] );
+
+    const unsigned long long checkers = getAttackers( kingIndex, occupiedSquares ) & opponentPieces;
+
+    // Where a piece other than the king has to move to deal with any check - capture the checker or get in its way.
+    // With two checkers, only the king can move
+    unsigned long long checkMask = ~0ull;
+    if ( checkers )
+    {
+        unsigned long checker;
+        scanForward( &checker, checkers );
+
+        checkMask = ( checkers & ( checkers - 1 ) ) ? 0 : BitBoard::getBetweenMask( kingIndex, checker ) | checkers;
+    }
+
+    // Moves elsewhere than the squares asked for are of no interest either
+    checkMask &= targetSquares;
+
+    // Pinned pieces are those of ours that are alone between our king and an opponent slider. Look out from the king
+    // through our own pieces to find the sliders that could be pinning something
+    unsigned long long pinnedPieces = 0;
+    unsigned long long pinners = ( BitBoard::getBishopAttacks( kingIndex, opponentPieces ) & ( bitboards[ opponentPieceIndex + BISHOP ] | bitboards[ opponentPieceIndex + QUEEN ] ) ) |
+                                 ( BitBoard::getRookAttacks( kingIndex, opponentPieces ) & ( bitboards[ opponentPieceIndex + ROOK ] | bitboards[ opponentPieceIndex + QUEEN ] ) );
+
+    unsigned long pinner;
+    while ( scanForward( &pinner, pinners ) )
+    {
+        pinners ^= 1ull << pinner;
+
+        const unsigned long long blockers = BitBoard::getBetweenMask( kingIndex, pinner ) & occupiedSquares;
+        if ( blockers && !( blockers & ( blockers - 1 ) ) )
+        {
+            pinnedPieces |= blockers & ~opponentPieces;
+        }
+    }
+
+    auto collator = [&] ( unsigned long from, unsigned long to, unsigned long extraBits = 0 ) -> bool
+    {
+        const unsigned long long fromBit = 1ull << from;
+        const unsigned long long toBit = 1ull << to;
+
+        if ( ( extraBits & Move::MOVING_PIECE ) == Move::MOVING_KING )
+        {
+            // The opponent's attack map sees through the king, so it can't hide from a slider behind itself.
+            // Castling has already been checked for moving out of, or through, check
+            if ( !( extraBits & Move::CASTLING_MASK ) && ( toBit & getAttackMap( !WHITE_TO_MOVE ) ) )
+            {
+                return true;
+            }
+        }
+        else if ( ( extraBits & Move::EP_CAPTURE ) == Move::EP_CAPTURE )
+        {
+            // This takes two pieces off the same rank at once, which can expose the king along that rank in a way the pin
+            // test can't see, so test the resulting position in full (which also covers pins and checks)
+            const unsigned long long capturedBit = WHITE_TO_MOVE ? toBit >> 8 : toBit << 8;
+            const unsigned long long occupancy = ( occupiedSquares ^ fromBit ^ capturedBit ) | toBit;
+
+            if ( getAttackers( kingIndex, occupancy ) & opponentPieces & ~capturedBit )
+            {
+                return true;
+            }
+        }
+        else
+        {
+            if ( !( toBit & checkMask ) )
+            {
+                return true;
+            }
+
+            // A pinned piece can only move along the line of the pin
+            if ( ( fromBit & pinnedPieces ) && !( toBit & BitBoard::getLineMask( kingIndex, from ) ) )
+            {
+                return true;
+            }
+        }
+
+        // Note what is being captured, for ordering
+        if ( extraBits & Move::CAPTURE )
+        {
+            extraBits |= ( extraBits & Move::EP_CAPTURE ) == Move::EP_CAPTURE ? Move::CAPTURE_PAWN : capturePieceBits( toBit );
+        }
+
+        Move move( from, to, extraBits );
+
+        // Are we getting ourselves out of check
+        if ( checkers )
+        {
+            move.setUncheckingMove();
+        }
+
+#ifdef SET_CHECK_FLAG
+        // Are we putting our oppenent into check?
+        const bool checking = givesCheck<WHITE_TO_MOVE>( from, to, extraBits );
+        if ( checking )
+        {
+            move.setCheckingMove();
+        }
+#else
+        const bool checking = GENERATION == Generation::QUIESCENT && givesCheck<WHITE_TO_MOVE>( from, to, extraBits );
+#endif
+
+        // For quiescence, a quiet move has to give check to be of interest
+        if ( GENERATION == Generation::QUIESCENT && !checkers && !checking && !( extraBits & ( Move::CAPTURE | Move::PROMOTION_MASK ) ) )
+        {
+            return true;
+        }
+
+        return consumer( move );
+    };
+
+    // Evasions can be quiet moves, so when in check everything is generated regardless
+    if constexpr ( GENERATION == Generation::QUIESCENT )
+    {
+        if ( checkers )
+        {
+            return generateMoves<WHITE_TO_MOVE, Generation::ALL>( collator, checkMask );
+        }
+    }
+
+    return generateMoves<WHITE_TO_MOVE, GENERATION>( collator, checkMask );
+}
+
+bool Board::getMovesLegacy( MoveList& moves )
 {
     const unsigned short bitboardPieceIndex = whiteToMove ? WHITE : BLACK;
     const unsigned short opponentPieceIndex = whiteToMove ? BLACK : WHITE;
@@ -40,6 +257,12 @@ bool Board::getMoves( std::vector<Move>& moves )
 
     auto collator = [&] ( unsigned long from, unsigned long to, unsigned long extraBits = 0 ) -> bool
     {
+        // Note what is being captured, as the legal generator does, so that the two give identical moves
+        if ( extraBits & Move::CAPTURE )
+        {
+            extraBits |= ( extraBits & Move::EP_CAPTURE ) == Move::EP_CAPTURE ? Move::CAPTURE_PAWN : capturePieceBits( 1ull << to );
+        }
+
         Move move( from, to, extraBits );
 
         applyMove( move );
@@ -73,53 +296,142 @@ bool Board::getMoves( std::vector<Move>& moves )
         return true;
     };
 
-    return getMoves( collator );
+    return whiteToMove ? generateMoves<true, Generation::ALL>( collator, ~0ull ) : generateMoves<false, Generation::ALL>( collator, ~0ull );
 }
 
-bool Board::getMoves( MoveCollator collator )
+bool Board::getMoves( MoveCollator collator ) const
 {
-    const unsigned short bitboardPieceIndex = whiteToMove ? WHITE : BLACK;
-    const unsigned short opponentPieceIndex = whiteToMove ? BLACK : WHITE;
+    // Adapter for callers that want to pass a std::function - the generator itself is specialised on the collator type
+    return whiteToMove ? generateMoves<true, Generation::ALL>( collator, ~0ull ) : generateMoves<false, Generation::ALL>( collator, ~0ull );
+}
+
+template <bool WHITE_TO_MOVE, Board::Generation GENERATION, typename Collator>
+bool Board::generateMoves( Collator& collator, const unsigned long long& targetSquares ) const
+{
+    const unsigned short bitboardPieceIndex = WHITE_TO_MOVE ? WHITE : BLACK;
+    const unsigned short opponentPieceIndex = WHITE_TO_MOVE ? BLACK : WHITE;
 
     const unsigned long long whitePieces = bitboards[ WHITE + PAWN ] | bitboards[ WHITE + KNIGHT ] | bitboards[ WHITE + BISHOP ] | bitboards[ WHITE + ROOK ] | bitboards[ WHITE + QUEEN ] | bitboards[ WHITE + KING ];
     const unsigned long long blackPieces = bitboards[ BLACK + PAWN ] | bitboards[ BLACK + KNIGHT ] | bitboards[ BLACK + BISHOP ] | bitboards[ BLACK + ROOK ] | bitboards[ BLACK + QUEEN ] | bitboards[ BLACK + KING ];
 
-    const unsigned long long& blockingPieces = whiteToMove ? whitePieces : blackPieces;
-    const unsigned long long& attackPieces = whiteToMove ? blackPieces : whitePieces;
+    const unsigned long long& attackPieces = WHITE_TO_MOVE ? blackPieces : whitePieces;
     const unsigned long long& accessibleSquares = bitboards[ EMPTY ] | attackPieces;
+    const unsigned long long& targetedSquares = accessibleSquares & targetSquares;
+
+    const unsigned long long promotionSquares = WHITE_TO_MOVE ? 0xff00000000000000ull : 0x00000000000000ffull;
+
+    // Enemy pieces or the empty en passant square (which is 0 if there is none)
+    unsigned long long pawnCaptureSquares = attackPieces | enPassantIndex;
+
+    unsigned long long pawnPushSquares = bitboards[ EMPTY ];
+    unsigned long long knightSquares = targetedSquares;
+    unsigned long long bishopSquares = targetedSquares;
+    unsigned long long rookSquares = targetedSquares;
+    unsigned long long queenSquares = targetedSquares;
+    unsigned long long kingSquares = accessibleSquares;
+
+    if constexpr ( GENERATION == Generation::QUIESCENT )
+    {
+        // The only quiet moves wanted are checks - so a piece only needs to go to the empty squares from which it would
+        // attack the opponent's king, unless it is in the way of one of our sliders and could give check by discovery.
+        // Either way, the collator keeps only those quiet moves that really do give check
+        const unsigned long long occupiedSquares = ~bitboards[ EMPTY ];
+        const unsigned long long ownPieces = WHITE_TO_MOVE ? whitePieces : blackPieces;
+
+        unsigned long kingIndex = 0;
+        scanForward( &kingIndex, bitboards[ opponentPieceIndex + KING ] );
+
+        // Look out from their king through our pieces to find our sliders, and then which of our pieces stand alone in their way
+        unsigned long long discoverers = 0;
+        unsigned long long sliders = ( BitBoard::getBishopAttacks( kingIndex, attackPieces ) & ( bitboards[ bitboardPieceIndex + BISHOP ] | bitboards[ bitboardPieceIndex + QUEEN ] ) ) |
+                                     ( BitBoard::getRookAttacks( kingIndex, attackPieces ) & ( bitboards[ bitboardPieceIndex + ROOK ] | bitboards[ bitboardPieceIndex + QUEEN ] ) );
+
+        unsigned long slider;
+        while ( scanForward( &slider, sliders ) )
+        {
+            sliders ^= 1ull << slider;
+
+            const unsigned long long blockers = BitBoard::getBetweenMask( kingIndex, slider ) & occupiedSquares;
+            if ( blockers && !( blockers & ( blockers - 1 ) ) )
+            {
+                discoverers |= blockers & ownPieces;
+            }
+        }
+
+        const unsigned long long diagonalChecks = BitBoard::getBishopAttacks( kingIndex, occupiedSquares );
+        const unsigned long long straightChecks = BitBoard::getRookAttacks( kingIndex, occupiedSquares );
+
+        auto quietSquares = [&] ( unsigned short piece, unsigned long long checkingSquares ) -> unsigned long long
+        {
+            return bitboards[ EMPTY ] & ( ( bitboards[ piece ] & discoverers ) ? ~0ull : checkingSquares );
+        };
+
+        // Squares a pawn of ours would attack the king from are those a pawn of theirs on the king's square would attack.
+        // A double push to one of them needs the single push square as well. Promotions are always wanted
+        const unsigned long long pawnChecks = WHITE_TO_MOVE ? BitBoard::getBlackPawnAttackMoveMask( kingIndex ) : BitBoard::getWhitePawnAttackMoveMask( kingIndex );
+        const unsigned long long doublePushChecks = WHITE_TO_MOVE ? ( pawnChecks & 0x00000000ff000000ull ) >> 8 : ( pawnChecks & 0x000000ff00000000ull ) << 8;
+
+        pawnPushSquares = quietSquares( bitboardPieceIndex + PAWN, pawnChecks | doublePushChecks | promotionSquares );
+        knightSquares = ( attackPieces | quietSquares( bitboardPieceIndex + KNIGHT, BitBoard::getKnightMoveMask( kingIndex ) ) ) & targetSquares;
+        bishopSquares = ( attackPieces | quietSquares( bitboardPieceIndex + BISHOP, diagonalChecks ) ) & targetSquares;
+        rookSquares = ( attackPieces | quietSquares( bitboardPieceIndex + ROOK, straightChecks ) ) & targetSquares;
+        queenSquares = ( attackPieces | quietSquares( bitboardPieceIndex + QUEEN, diagonalChecks | straightChecks ) ) & targetSquares;
+        kingSquares = attackPieces | quietSquares( bitboardPieceIndex + KING, 0 );
+    }
+    else if constexpr ( GENERATION == Generation::CAPTURES )
+    {
+        // Pawns only push to promote, and everything else only goes where it captures
+        pawnPushSquares = bitboards[ EMPTY ] & promotionSquares;
+        knightSquares = attackPieces & targetSquares;
+        bishopSquares = knightSquares;
+        rookSquares = knightSquares;
+        queenSquares = knightSquares;
+        kingSquares = attackPieces;
+    }
+    else if constexpr ( GENERATION == Generation::QUIETS )
+    {
+        // Everything that CAPTURES leaves out. A double push needs its single push square, which is never a promotion
+        pawnPushSquares = bitboards[ EMPTY ] & ~promotionSquares;
+        pawnCaptureSquares = 0;
+        knightSquares = bitboards[ EMPTY ] & targetSquares;
+        bishopSquares = knightSquares;
+        rookSquares = knightSquares;
+        queenSquares = knightSquares;
+        kingSquares = bitboards[ EMPTY ];
+    }
 
     // Pawn (including ep capture, promotion)
-    if ( !getPawnMoves( bitboardPieceIndex + PAWN, bitboards[ EMPTY ], attackPieces, collator ) )
+    if ( !getPawnMoves<WHITE_TO_MOVE>( bitboardPieceIndex + PAWN, pawnPushSquares, pawnCaptureSquares, collator ) )
     {
         return false;
     }
 
     // Knight
-    if ( !getKnightMoves( bitboardPieceIndex + KNIGHT, accessibleSquares, attackPieces, collator ) )
+    if ( !getKnightMoves( bitboardPieceIndex + KNIGHT, knightSquares, attackPieces, collator ) )
     {
         return false;
     }
 
     // Bishop + Queen
-    if ( !getBishopMoves( bitboardPieceIndex + BISHOP, accessibleSquares, attackPieces, blockingPieces, collator ) )
+    if ( !getBishopMoves( bitboardPieceIndex + BISHOP, bishopSquares, attackPieces, collator ) )
     {
         return false;
     }
 
     // Rook (including castling flag set) + Queen
-    if ( !getRookMoves( bitboardPieceIndex + ROOK, accessibleSquares, attackPieces, blockingPieces, collator ) )
+    if ( !getRookMoves( bitboardPieceIndex + ROOK, rookSquares, attackPieces, collator ) )
     {
         return false;
     }
 
     // Queen
-    if ( !getQueenMoves( bitboardPieceIndex + QUEEN, accessibleSquares, attackPieces, blockingPieces, collator ) )
+    if ( !getQueenMoves( bitboardPieceIndex + QUEEN, queenSquares, attackPieces, collator ) )
     {
         return false;
     }
 
     // King (including castling, castling flag set)
-    if ( !getKingMoves( bitboardPieceIndex + KING, accessibleSquares, attackPieces, collator ) )
+    if ( !getKingMoves<WHITE_TO_MOVE, GENERATION>( bitboardPieceIndex + KING, kingSquares, attackPieces, collator ) )
     {
         return false;
     }
@@ -127,43 +439,132 @@ bool Board::getMoves( MoveCollator collator )
     return true;
 }
 
-void Board::sortMoves( std::vector<Move>& moves )
+void Board::sortMoves( MoveList& moves ) const
+{
+    scoreMoves( moves );
+
+    moves.sortByScore();
+}
+
+void Board::scoreMoves( MoveList& moves, size_t first ) const
 {
-    // Sort the moves by contextual elements
-    std::sort( moves.begin(), moves.end(), [&] ( Move a, Move b )
+    // Above any of the contextual bits, which are shifted up to leave room for finer ordering of quiet moves
+    static const int WINNING_CAPTURE = 1 << 28;
+    static const int CONTEXT_SHIFT = 16;
+
+    for ( size_t loop = first; loop < moves.size(); loop++ )
     {
-#ifdef SET_CHECK_FLAG
-        if ( a.isCheckingMove() != b.isCheckingMove() ) // includes en passant
+        const Move& move = moves[ loop ];
+
+        int score = 0;
+        if ( move.isCapture() || move.isPromotion() )
         {
-            return a.isCheckingMove();
-        }
+            const short exchange = staticExchange( move );
+            if ( exchange >= 0 )
+            {
+                // MVV-LVA - the victim (none, or pawn up to queen) then the attacker, reversed (king up to pawn) - and the
+                // promotion piece, 0 or 0b1000 (knight) up to 0b1110 (queen)
+                score = WINNING_CAPTURE |
+                        static_cast<int>( ( move.getCapturePiece() >> 23 ) << 8 ) |
+                        static_cast<int>( ( 7 - ( move.getMovingPiece() >> 20 ) ) << 4 ) |
+                        static_cast<int>( move.getPromotionPiece() >> 11 );
+            }
+#ifdef SET_CHECK_FLAG
+            else if ( move.isCheckingMove() )
+            {
+                // Still worth trying with the other checks
+                score = 0b10000000 << CONTEXT_SHIFT;
+            }
 #endif
-        if ( a.isUncheckingMove() != b.isUncheckingMove() ) // includes en passant
-        {
-            return a.isUncheckingMove();
-        }
-        if ( a.isCapture() != b.isCapture() ) // includes en passant
-        {
-            return a.isCapture();
+            else
+            {
+                score = exchange;
+            }
         }
-        if ( a.isPromotion() != b.isPromotion() )
+        else
         {
-            return a.isPromotion();
+            // The rest by contextual elements, most significant first: checks, check evasions and then castling
+#ifdef SET_CHECK_FLAG
+            score |= move.isCheckingMove() ? 0b10000000 : 0;
+#endif
+            score |= move.isUncheckingMove() ? 0b01000000 : 0;
+            score |= move.isCastling() ? 0b00000001 : 0;
+            score <<= CONTEXT_SHIFT;
         }
-        else
+
+        moves.setScore( loop, score );
+    }
+}
+
+short Board::staticExchange( const Move& move ) const
+{
+    const unsigned short sides[ 2 ] = { whiteToMove ? WHITE : BLACK, whiteToMove ? BLACK : WHITE };
+
+    const unsigned long to = move.getTo();
+    const unsigned long long fromBit = 1ull << move.getFrom();
+    const unsigned long long toBit = 1ull << to;
+
+    // gain[ n ] is what the side making the nth capture has won, if the other side then recaptures
+    std::array<int, 32> gain;
+    size_t depth = 0;
+
+    // The value of what is captured first, and of what is left standing on the square to be captured next
+    const unsigned short victim = bitboardArrayIndexFromBit( toBit );
+    gain[ 0 ] = move.isEnPassant() ? PIECE_VALUES[ PAWN ] : victim == EMPTY ? 0 : PIECE_VALUES[ victim - sides[ 1 ] ];
+    int pieceOnSquare = PIECE_VALUES[ bitboardArrayIndexFromBit( fromBit ) - sides[ 0 ] ];
+
+    if ( move.isPromotion() )
+    {
+        const int promoted = PIECE_VALUES[ bitboardArrayIndexFromPromotion( move.getPromotionPiece() ) ];
+        gain[ 0 ] += promoted - PIECE_VALUES[ PAWN ];
+        pieceOnSquare = promoted;
+    }
+
+    unsigned long long occupancy = ~bitboards[ EMPTY ] ^ fromBit;
+    if ( move.isEnPassant() )
+    {
+        occupancy ^= whiteToMove ? toBit >> 8 : toBit << 8;
+    }
+
+    unsigned short side = 1;
+    while ( depth < gain.size() - 1 )
+    {
+        // Worked out afresh each time from what is left on the board, so that sliders behind pieces already used show up
+        const unsigned long long attackers = getAttackers( to, occupancy ) & occupancy;
+
+        unsigned long long attackerBits = 0;
+        unsigned short attacker = PAWN;
+        for ( ; attacker <= KING; attacker++ )
         {
-            // Will be 0 (no promotion) or a promotion piece (q,r,b,n) where we want q first
-            if ( a.getPromotionPiece() != b.getPromotionPiece() )
+            attackerBits = attackers & bitboards[ sides[ side ] + attacker ];
+            if ( attackerBits )
             {
-                return a.getPromotionPiece() > b.getPromotionPiece();
+                break;
             }
         }
-        if ( a.isCastling() != b.isCastling() )
+
+        if ( !attackerBits )
         {
-            return a.isCastling();
+            break;
         }
-        return false;
-    } );
+
+        depth++;
+        gain[ depth ] = pieceOnSquare - gain[ depth - 1 ];
+
+        pieceOnSquare = PIECE_VALUES[ attacker ];
+        occupancy ^= attackerBits & ( ~attackerBits + 1 );
+        side ^= 1;
+    }
+
+    // Work back, letting each side choose between capturing and stopping - the whole list is kept, rather than cutting
+    // it short, so that the value is exact and not just of the right sign
+    while ( depth > 0 )
+    {
+        gain[ depth - 1 ] = -std::max( -gain[ depth - 1 ], gain[ depth ] );
+        depth--;
+    }
+
+    return static_cast<short>( gain[ 0 ] );
 }
 
 // TODO turn this into two methods - makeMove that creates and returns a state and calls applyMove, which does only that
@@ -192,6 +593,14 @@ void Board::applyMove( const Move& move )
     unsigned short fromPiece = bitboardArrayIndexFromBit( fromBit );
     unsigned short toPiece = bitboardArrayIndexFromBit( toBit );
 
+    // Remember these so we can fold any changes into the hash key once the move is complete
+    const std::array<bool, 4> previousCastlingRights = castlingRights;
+
+    // Likewise the pieces that come and go, for the accumulator
+    addedCount = 0;
+    removedCount = 0;
+    const unsigned long long previousEnPassantIndex = enPassantIndex;
+
     //std::cerr << "Making Move: " << move.toString() << " for " << (char*) ( whiteToMove ? "white" : "black" ) << " with a " << pieceFromBitboardArrayIndex( fromPiece ) << std::endl;
 
     // Find which piece is moving and move it, with any required side-effects
@@ -307,6 +716,26 @@ void Board::applyMove( const Move& move )
 
     whiteToMove = !whiteToMove;
 
+    // Update the hash key for the non-piece changes (the piece changes were handled as they happened)
+    hashKey ^= Zobrist::getBlackToMoveKey();
+
+    if ( previousEnPassantIndex )
+    {
+        hashKey ^= Zobrist::getEnPassantKey( squareFromBit( previousEnPassantIndex ) );
+    }
+    if ( enPassantIndex )
+    {
+        hashKey ^= Zobrist::getEnPassantKey( squareFromBit( enPassantIndex ) );
+    }
+
+    for ( unsigned short loop = 0; loop < 4; loop++ )
+    {
+        if ( castlingRights[ loop ] != previousCastlingRights[ loop ] )
+        {
+            hashKey ^= Zobrist::getCastlingKey( loop );
+        }
+    }
+
     if ( whiteToMove )
     {
         fullMoveNumber++;
@@ -321,6 +750,37 @@ void Board::applyMove( const Move& move )
     {
         halfMoveClock++;
     }
+
+    if ( accumulator )
+    {
+        updateAccumulator();
+    }
+}
+
+void Board::applyNullMove()
+{
+    // Only the side to move changes, and any chance of an en passant capture goes
+    if ( enPassantIndex )
+    {
+        hashKey ^= Zobrist::getEnPassantKey( squareFromBit( enPassantIndex ) );
+        enPassantIndex = 0;
+    }
+
+    whiteToMove = !whiteToMove;
+    hashKey ^= Zobrist::getBlackToMoveKey();
+
+    if ( whiteToMove )
+    {
+        fullMoveNumber++;
+    }
+    halfMoveClock++;
+}
+
+bool Board::hasNonPawnMaterial() const
+{
+    const unsigned short bitboardPieceIndex = whiteToMove ? WHITE : BLACK;
+
+    return bitboards[ bitboardPieceIndex + KNIGHT ] | bitboards[ bitboardPieceIndex + BISHOP ] | bitboards[ bitboardPieceIndex + ROOK ] | bitboards[ bitboardPieceIndex + QUEEN ];
 }
 
 void Board::unmakeMove( const Board::State& state )
@@ -471,12 +931,200 @@ Board* Board::createBoard( const std::string& fen )
         ep = 1ull << ( ( ( enPassant[ 1 ] - '1' ) << 3 ) | ( enPassant[ 0 ] - 'a' ) );
     }
 
-    return new Board( bitboards,
-                      whiteToPlay,
-                      castlingRights,
-                      ep,
-                      atoi( halfMoveClock.c_str() ),
-                      atoi( fullMoveNumber.c_str() ) );
+    Board* board = new Board( bitboards,
+                              whiteToPlay,
+                              castlingRights,
+                              ep,
+                              atoi( halfMoveClock.c_str() ),
+                              atoi( fullMoveNumber.c_str() ) );
+
+    // This is the only time we need to calculate these from scratch
+    board->hashKey = board->computeHashKey();
+    board->pawnHashKey = board->computePawnHashKey();
+    board->computePieceSquareScores();
+
+    // Anything but the key will do to mark the attack maps as not yet worked out
+    board->attackMapsKey = ~board->hashKey;
+
+    return board;
+}
+
+unsigned long long Board::computeHashKey() const
+{
+    unsigned long long key = 0;
+
+    // Skip EMPTY as it does not contribute
+    for ( unsigned short piece = 1; piece < bitboards.size(); piece++ )
+    {
+        unsigned long long pieces = bitboards[ piece ];
+        unsigned long index;
+        while ( scanForward( &index, pieces ) )
+        {
+            pieces ^= 1ull << index;
+
+            key ^= Zobrist::getPieceKey( piece, index );
+        }
+    }
+
+    if ( !whiteToMove )
+    {
+        key ^= Zobrist::getBlackToMoveKey();
+    }
+
+    for ( unsigned short loop = 0; loop < 4; loop++ )
+    {
+        if ( castlingRights[ loop ] )
+        {
+            key ^= Zobrist::getCastlingKey( loop );
+        }
+    }
+
+    if ( enPassantIndex )
+    {
+        key ^= Zobrist::getEnPassantKey( squareFromBit( enPassantIndex ) );
+    }
+
+    return key;
+}
+
+unsigned long long Board::computePawnHashKey() const
+{
+    unsigned long long key = 0;
+
+    for ( unsigned short piece : { WHITE + PAWN, BLACK + PAWN } )
+    {
+        unsigned long long pieces = bitboards[ piece ];
+        unsigned long index;
+        while ( scanForward( &index, pieces ) )
+        {
+            pieces ^= 1ull << index;
+
+            key ^= Zobrist::getPawnKey( piece, index );
+        }
+    }
+
+    return key;
+}
+
+void Board::setAccumulators( Nnue::Accumulator* first, Nnue::Accumulator* last )
+{
+    accumulator = first;
+    accumulatorEnd = last;
+
+    if ( accumulator )
+    {
+        refreshAccumulator( *accumulator, 0 );
+        refreshAccumulator( *accumulator, 1 );
+    }
+}
+
+void Board::refreshAccumulator( Nnue::Accumulator& target, unsigned short perspective ) const
+{
+    // Left on a1 should a position set up without this side's king reach here
+    unsigned long kingSquare = 0;
+    scanForward( &kingSquare, bitboards[ ( perspective == 0 ? WHITE : BLACK ) + KING ] );
+
+    // Room for a piece on every square - a position set up from FEN isn't limited to fifteen a side
+    unsigned int features[ 64 ];
+    unsigned int count = 0;
+
+    for ( unsigned short side : { WHITE, BLACK } )
+    {
+        for ( unsigned short piece = side + PAWN; piece <= side + QUEEN; piece++ )
+        {
+            unsigned long long pieces = bitboards[ piece ];
+            unsigned long index;
+            while ( scanForward( &index, pieces ) )
+            {
+                pieces ^= 1ull << index;
+
+                features[ count++ ] = Nnue::featureIndex( perspective, kingSquare, piece, index );
+            }
+        }
+    }
+
+    Nnue::refresh( target.values[ perspective ], features, count );
+}
+
+void Board::updateAccumulator()
+{
+    const Nnue::Accumulator* previous = accumulator;
+
+    // Out of room, so do without the network until unmaking the move brings back the accumulator before this one
+    if ( accumulator + 1 == accumulatorEnd )
+    {
+        accumulator = nullptr;
+        return;
+    }
+    accumulator++;
+
+    for ( unsigned short perspective = 0; perspective < 2; perspective++ )
+    {
+        const unsigned short king = ( perspective == 0 ? WHITE : BLACK ) + KING;
+
+        unsigned long kingSquare = 0;
+        scanForward( &kingSquare, bitboards[ king ] );
+
+        // Kings aren't inputs in themselves - except that where this side's king stands changes every input it has
+        bool kingMoved = false;
+
+        unsigned int added[ 4 ];
+        unsigned int addedFeatures = 0;
+        for ( unsigned short change = 0; change < addedCount; change++ )
+        {
+            const Nnue::Change& piece = addedPieces[ change ];
+            if ( piece.piece == WHITE + KING || piece.piece == BLACK + KING )
+            {
+                kingMoved |= piece.piece == king;
+            }
+            else
+            {
+                added[ addedFeatures++ ] = Nnue::featureIndex( perspective, kingSquare, piece.piece, piece.square );
+            }
+        }
+
+        unsigned int removed[ 4 ];
+        unsigned int removedFeatures = 0;
+        for ( unsigned short change = 0; change < removedCount; change++ )
+        {
+            const Nnue::Change& piece = removedPieces[ change ];
+            if ( piece.piece != WHITE + KING && piece.piece != BLACK + KING )
+            {
+                removed[ removedFeatures++ ] = Nnue::featureIndex( perspective, kingSquare, piece.piece, piece.square );
+            }
+        }
+
+        if ( kingMoved )
+        {
+            refreshAccumulator( *accumulator, perspective );
+        }
+        else
+        {
+            Nnue::update( accumulator->values[ perspective ], previous->values[ perspective ], added, addedFeatures, removed, removedFeatures );
+        }
+    }
+}
+
+void Board::computePieceSquareScores()
+{
+    middlegameScore = 0;
+    endgameScore = 0;
+    phase = 0;
+
+    // Skip EMPTY as it does not contribute
+    for ( unsigned short piece = 1; piece < bitboards.size(); piece++ )
+    {
+        unsigned long long pieces = bitboards[ piece ];
+        unsigned long index;
+        while ( scanForward( &index, pieces ) )
+        {
+            pieces ^= 1ull << index;
+
+            middlegameScore += PieceSquareTables::getMiddlegameValue( piece, index );
+            endgameScore += PieceSquareTables::getEndgameValue( piece, index );
+            phase += PieceSquareTables::getPhaseWeight( piece );
+        }
+    }
 }
 
 std::string Board::toString() const
@@ -651,7 +1299,15 @@ Board::State::State( const Board* board ) :
     castlingRights( board->castlingRights ),
     enPassantIndex( board->enPassantIndex ),
     halfMoveClock( board->halfMoveClock ),
-    fullMoveNumber( board->fullMoveNumber )
+    fullMoveNumber( board->fullMoveNumber ),
+    hashKey( board->hashKey ),
+    pawnHashKey( board->pawnHashKey ),
+    middlegameScore( board->middlegameScore ),
+    endgameScore( board->endgameScore ),
+    phase( board->phase ),
+    attackMaps( board->attackMaps ),
+    attackMapsKey( board->attackMapsKey ),
+    accumulator( board->accumulator )
 {
 }
 
@@ -661,7 +1317,15 @@ Board::State::State( const Board& board ) :
     castlingRights( board.castlingRights ),
     enPassantIndex( board.enPassantIndex ),
     halfMoveClock( board.halfMoveClock ),
-    fullMoveNumber( board.fullMoveNumber )
+    fullMoveNumber( board.fullMoveNumber ),
+    hashKey( board.hashKey ),
+    pawnHashKey( board.pawnHashKey ),
+    middlegameScore( board.middlegameScore ),
+    endgameScore( board.endgameScore ),
+    phase( board.phase ),
+    attackMaps( board.attackMaps ),
+    attackMapsKey( board.attackMapsKey ),
+    accumulator( board.accumulator )
 {
 }
 
@@ -673,6 +1337,14 @@ void Board::State::apply( Board* board ) const
     board->enPassantIndex = enPassantIndex;
     board->halfMoveClock = halfMoveClock;
     board->fullMoveNumber = fullMoveNumber;
+    board->hashKey = hashKey;
+    board->pawnHashKey = pawnHashKey;
+    board->middlegameScore = middlegameScore;
+    board->endgameScore = endgameScore;
+    board->phase = phase;
+    board->attackMaps = attackMaps;
+    board->attackMapsKey = attackMapsKey;
+    board->accumulator = accumulator;
 }
 
 void Board::State::apply( Board& board ) const
@@ -683,14 +1355,23 @@ void Board::State::apply( Board& board ) const
     board.enPassantIndex = enPassantIndex;
     board.halfMoveClock = halfMoveClock;
     board.fullMoveNumber = fullMoveNumber;
+    board.hashKey = hashKey;
+    board.pawnHashKey = pawnHashKey;
+    board.middlegameScore = middlegameScore;
+    board.endgameScore = endgameScore;
+    board.phase = phase;
+    board.attackMaps = attackMaps;
+    board.attackMapsKey = attackMapsKey;
+    board.accumulator = accumulator;
 }
 
-bool Board::getPawnMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, MoveCollator moveCollator )
+template <bool WHITE_TO_MOVE, typename Collator>
+bool Board::getPawnMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& captureSquares, Collator& moveCollator ) const
 {
     static const unsigned long promotionPieces[] = { Move::KNIGHT, Move::BISHOP, Move::ROOK, Move::QUEEN };
 
-    const unsigned short promotionRankFrom = whiteToMove ? 6 : 1;
-    const unsigned short homeRankFrom = whiteToMove ? 1 : 6;
+    const unsigned short promotionRankFrom = WHITE_TO_MOVE ? 6 : 1;
+    const unsigned short homeRankFrom = WHITE_TO_MOVE ? 1 : 6;
 
     unsigned long long pieces;
     unsigned long index;
@@ -707,7 +1388,7 @@ bool Board::getPawnMoves( const unsigned short& pieceIndex, const unsigned long
 
         rankFrom = ( index >> 3 ) & 0b00000111;
 
-        possibleMoves = whiteToMove ? BitBoard::getWhitePawnNormalMoveMask( index ) : BitBoard::getBlackPawnNormalMoveMask( index );
+        possibleMoves = WHITE_TO_MOVE ? BitBoard::getWhitePawnNormalMoveMask( index ) : BitBoard::getBlackPawnNormalMoveMask( index );
         possibleMoves &= accessibleSquares; // In this case, empty squares
 
         while ( scanForward( &destination, possibleMoves ) )
@@ -748,7 +1429,7 @@ bool Board::getPawnMoves( const unsigned short& pieceIndex, const unsigned long
     {
         pieces ^= 1ull << index;
 
-        possibleMoves = whiteToMove ? BitBoard::getWhitePawnExtendedMoveMask( index ) : BitBoard::getBlackPawnExtendedMoveMask( index );
+        possibleMoves = WHITE_TO_MOVE ? BitBoard::getWhitePawnExtendedMoveMask( index ) : BitBoard::getBlackPawnExtendedMoveMask( index );
         possibleMoves &= accessibleSquares; // In this case, empty squares
 
         while ( scanForward( &destination, possibleMoves ) )
@@ -771,8 +1452,8 @@ bool Board::getPawnMoves( const unsigned short& pieceIndex, const unsigned long
 
         rankFrom = ( index >> 3 ) & 0b00000111;
 
-        possibleMoves = whiteToMove ? BitBoard::getWhitePawnAttackMoveMask( index ) : BitBoard::getBlackPawnAttackMoveMask( index );
-        possibleMoves &= ( attackPieces | enPassantIndex ); // enemy pieces or the empty EP square (which is 0 if there is none)
+        possibleMoves = WHITE_TO_MOVE ? BitBoard::getWhitePawnAttackMoveMask( index ) : BitBoard::getBlackPawnAttackMoveMask( index );
+        possibleMoves &= captureSquares;
 
         while ( scanForward( &destination, possibleMoves ) )
         {
@@ -803,7 +1484,8 @@ bool Board::getPawnMoves( const unsigned short& pieceIndex, const unsigned long
     return true;
 }
 
-bool Board::getKnightMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, MoveCollator moveCollator )
+template <typename Collator>
+bool Board::getKnightMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, Collator& moveCollator ) const
 {
     unsigned long long pieces;
     unsigned long index;
@@ -835,30 +1517,20 @@ bool Board::getKnightMoves( const unsigned short& pieceIndex, const unsigned lon
     return true;
 }
 
-bool Board::getBishopMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces, MoveCollator moveCollator )
+template <typename Collator>
+bool Board::getBishopMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, Collator& moveCollator ) const
 {
     unsigned long long pieces;
     unsigned long index;
 
+    const unsigned long long occupiedSquares = ~bitboards[ EMPTY ];
+
     pieces = bitboards[ pieceIndex ];
     while ( scanForward( &index, pieces ) )
     {
         pieces ^= 1ull << index;
 
-        if ( !getDirectionalMoves( index, Move::MOVING_BISHOP, attackPieces, blockingPieces, BitBoard::getNorthEastMoveMask, scanForward, moveCollator ) )
-        {
-            return false;
-        }
-        if ( !getDirectionalMoves( index, Move::MOVING_BISHOP, attackPieces, blockingPieces, BitBoard::getNorthWestMoveMask, scanForward, moveCollator ) )
-        {
-            return false;
-        }
-
-        if ( !getDirectionalMoves( index, Move::MOVING_BISHOP, attackPieces, blockingPieces, BitBoard::getSouthWestMoveMask, scanReverse, moveCollator ) )
-        {
-            return false;
-        }
-        if ( !getDirectionalMoves( index, Move::MOVING_BISHOP, attackPieces, blockingPieces, BitBoard::getSouthEastMoveMask, scanReverse, moveCollator ) )
+        if ( !getSlidingMoves( index, Move::MOVING_BISHOP, BitBoard::getBishopAttacks( index, occupiedSquares ) & accessibleSquares, attackPieces, moveCollator ) )
         {
             return false;
         }
@@ -867,30 +1539,20 @@ bool Board::getBishopMoves( const unsigned short& pieceIndex, const unsigned lon
     return true;
 }
 
-bool Board::getRookMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces, MoveCollator moveCollator )
+template <typename Collator>
+bool Board::getRookMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, Collator& moveCollator ) const
 {
     unsigned long long pieces;
     unsigned long index;
 
+    const unsigned long long occupiedSquares = ~bitboards[ EMPTY ];
+
     pieces = bitboards[ pieceIndex ];
     while ( scanForward( &index, pieces ) )
     {
         pieces ^= 1ull << index;
 
-        if ( !getDirectionalMoves( index, Move::MOVING_ROOK, attackPieces, blockingPieces, BitBoard::getNorthMoveMask, scanForward, moveCollator ) )
-        {
-            return false;
-        }
-        if ( !getDirectionalMoves( index, Move::MOVING_ROOK, attackPieces, blockingPieces, BitBoard::getWestMoveMask, scanForward, moveCollator ) )
-        {
-            return false;
-        }
-
-        if ( !getDirectionalMoves( index, Move::MOVING_ROOK, attackPieces, blockingPieces, BitBoard::getSouthMoveMask, scanReverse, moveCollator ) )
-        {
-            return false;
-        }
-        if ( !getDirectionalMoves( index, Move::MOVING_ROOK, attackPieces, blockingPieces, BitBoard::getEastMoveMask, scanReverse, moveCollator ) )
+        if ( !getSlidingMoves( index, Move::MOVING_ROOK, BitBoard::getRookAttacks( index, occupiedSquares ) & accessibleSquares, attackPieces, moveCollator ) )
         {
             return false;
         }
@@ -899,46 +1561,20 @@ bool Board::getRookMoves( const unsigned short& pieceIndex, const unsigned long
     return true;
 }
 
-bool Board::getQueenMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces, MoveCollator moveCollator )
+template <typename Collator>
+bool Board::getQueenMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, Collator& moveCollator ) const
 {
     unsigned long long pieces;
     unsigned long index;
 
+    const unsigned long long occupiedSquares = ~bitboards[ EMPTY ];
+
     pieces = bitboards[ pieceIndex ];
     while ( scanForward( &index, pieces ) )
     {
         pieces ^= 1ull << index;
 
-        if ( !getDirectionalMoves( index, Move::MOVING_QUEEN, attackPieces, blockingPieces, BitBoard::getNorthMoveMask, scanForward, moveCollator ) )
-        {
-            return false;
-        }
-        if ( !getDirectionalMoves( index, Move::MOVING_QUEEN, attackPieces, blockingPieces, BitBoard::getWestMoveMask, scanForward, moveCollator ) )
-        {
-            return false;
-        }
-        if ( !getDirectionalMoves( index, Move::MOVING_QUEEN, attackPieces, blockingPieces, BitBoard::getNorthEastMoveMask, scanForward, moveCollator ) )
-        {
-            return false;
-        }
-        if ( !getDirectionalMoves( index, Move::MOVING_QUEEN, attackPieces, blockingPieces, BitBoard::getNorthWestMoveMask, scanForward, moveCollator ) )
-        {
-            return false;
-        }
-
-        if ( !getDirectionalMoves( index, Move::MOVING_QUEEN, attackPieces, blockingPieces, BitBoard::getSouthMoveMask, scanReverse, moveCollator ) )
-        {
-            return false;
-        }
-        if ( !getDirectionalMoves( index, Move::MOVING_QUEEN, attackPieces, blockingPieces, BitBoard::getEastMoveMask, scanReverse, moveCollator ) )
-        {
-            return false;
-        }
-        if ( !getDirectionalMoves( index, Move::MOVING_QUEEN, attackPieces, blockingPieces, BitBoard::getSouthWestMoveMask, scanReverse, moveCollator ) )
-        {
-            return false;
-        }
-        if ( !getDirectionalMoves( index, Move::MOVING_QUEEN, attackPieces, blockingPieces, BitBoard::getSouthEastMoveMask, scanReverse, moveCollator ) )
+        if ( !getSlidingMoves( index, Move::MOVING_QUEEN, BitBoard::getQueenAttacks( index, occupiedSquares ) & accessibleSquares, attackPieces, moveCollator ) )
         {
             return false;
         }
@@ -947,7 +1583,8 @@ bool Board::getQueenMoves( const unsigned short& pieceIndex, const unsigned long
     return true;
 }
 
-bool Board::getKingMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, MoveCollator moveCollator )
+template <bool WHITE_TO_MOVE, Board::Generation GENERATION, typename Collator>
+bool Board::getKingMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, Collator& moveCollator ) const
 {
     unsigned long long pieces;
     unsigned long index;
@@ -974,11 +1611,17 @@ bool Board::getKingMoves( const unsigned short& pieceIndex, const unsigned long
             }
         }
 
+        // Castling is a quiet move, and not looked at in quiescence
+        if constexpr ( GENERATION == Generation::QUIESCENT || GENERATION == Generation::CAPTURES )
+        {
+            return true;
+        }
+
         // Check whether castling is a possibility
         const unsigned long long emptySquares = bitboards[ EMPTY ];
         unsigned long long castlingMask;
 
-        if ( whiteToMove )
+        if constexpr ( WHITE_TO_MOVE )
         {
             if ( castlingRights[ 0 ] )
             {
@@ -987,7 +1630,7 @@ bool Board::getKingMoves( const unsigned short& pieceIndex, const unsigned long
                 if ( ( emptySquares & castlingMask ) == castlingMask )
                 {
                     // Test for the king travelling through check
-                    if ( !isAttacked( 0b01110000, whiteToMove ) )
+                    if ( !( getAttackMap( !WHITE_TO_MOVE ) & 0b01110000 ) )
                     {
                         if ( !moveCollator( index, index + 2, Move::MOVING_KING | Move::CASTLING_KSIDE ) )
                         {
@@ -1002,7 +1645,7 @@ bool Board::getKingMoves( const unsigned short& pieceIndex, const unsigned long
 
                 if ( ( emptySquares & castlingMask ) == castlingMask )
                 {
-                    if ( !isAttacked( 0b00011100, whiteToMove ) )
+                    if ( !( getAttackMap( !WHITE_TO_MOVE ) & 0b00011100 ) )
                     {
                         if ( !moveCollator( index, index - 2, Move::MOVING_KING | Move::CASTLING_QSIDE ) )
                         {
@@ -1020,7 +1663,7 @@ bool Board::getKingMoves( const unsigned short& pieceIndex, const unsigned long
 
                 if ( ( emptySquares & castlingMask ) == castlingMask )
                 {
-                    if ( !isAttacked( 0b0111000000000000000000000000000000000000000000000000000000000000, whiteToMove ) )
+                    if ( !( getAttackMap( !WHITE_TO_MOVE ) & 0b0111000000000000000000000000000000000000000000000000000000000000 ) )
                     {
                         if ( !moveCollator( index, index + 2, Move::MOVING_KING | Move::CASTLING_KSIDE ) )
                         {
@@ -1035,7 +1678,7 @@ bool Board::getKingMoves( const unsigned short& pieceIndex, const unsigned long
 
                 if ( ( emptySquares & castlingMask ) == castlingMask )
                 {
-                    if ( !isAttacked( 0b0001110000000000000000000000000000000000000000000000000000000000, whiteToMove ) )
+                    if ( !( getAttackMap( !WHITE_TO_MOVE ) & 0b0001110000000000000000000000000000000000000000000000000000000000 ) )
                     {
                         if ( !moveCollator( index, index - 2, Move::MOVING_KING | Move::CASTLING_QSIDE ) )
                         {
@@ -1050,7 +1693,7 @@ bool Board::getKingMoves( const unsigned short& pieceIndex, const unsigned long
     return true;
 }
 
-bool Board::isAttacked( unsigned long long mask, bool asWhite )
+bool Board::isAttacked( unsigned long long mask, bool asWhite ) const
 {
     const unsigned short bitboardPieceIndex = asWhite ? BLACK : WHITE;
 
@@ -1058,6 +1701,8 @@ bool Board::isAttacked( unsigned long long mask, bool asWhite )
     unsigned long long diagonalPieces = bitboards[ bitboardPieceIndex + BISHOP ] | bitboards[ bitboardPieceIndex + QUEEN ];
     unsigned long long crossingPieces = bitboards[ bitboardPieceIndex + ROOK ] | bitboards[ bitboardPieceIndex + QUEEN ];
 
+    const unsigned long long occupiedSquares = ~bitboards[ EMPTY ];
+
     // For each mask square...
 
     unsigned long index;
@@ -1084,19 +1729,13 @@ bool Board::isAttacked( unsigned long long mask, bool asWhite )
         }
 
         // Bishop + Queen
-        if ( isAttacked( index, diagonalPieces, BitBoard::getNorthWestMoveMask, scanForward ) ||
-             isAttacked( index, diagonalPieces, BitBoard::getNorthEastMoveMask, scanForward ) ||
-             isAttacked( index, diagonalPieces, BitBoard::getSouthWestMoveMask, scanReverse ) ||
-             isAttacked( index, diagonalPieces, BitBoard::getSouthEastMoveMask, scanReverse ) )
+        if ( BitBoard::getBishopAttacks( index, occupiedSquares ) & diagonalPieces )
         {
             return true;
         }
 
         // Rook + Queen
-        if ( isAttacked( index, crossingPieces, BitBoard::getNorthMoveMask, scanForward ) ||
-             isAttacked( index, crossingPieces, BitBoard::getWestMoveMask, scanForward ) ||
-             isAttacked( index, crossingPieces, BitBoard::getSouthMoveMask, scanReverse ) ||
-             isAttacked( index, crossingPieces, BitBoard::getEastMoveMask, scanReverse ) )
+        if ( BitBoard::getRookAttacks( index, occupiedSquares ) & crossingPieces )
         {
             return true;
         }
@@ -1113,123 +1752,366 @@ bool Board::isAttacked( unsigned long long mask, bool asWhite )
     return false;
 }
 
-bool Board::isAttacked( const unsigned long& index, const unsigned long long& attackingPieces, DirectionMask directionMask, BitScanner bitScanner )
+template <typename Collator>
+bool Board::getSlidingMoves( const unsigned long& index, const unsigned long piece, unsigned long long possibleMoves, const unsigned long long& attackPieces, Collator& moveCollator ) const
 {
-    unsigned long long attackMask = directionMask( index ) & ~bitboards[ EMPTY ];
+    unsigned long destination;
 
-    unsigned long closest;
-    if ( bitScanner( &closest, attackMask ) )
+    // The attack lookup has already stopped each ray at the first piece in the way, and the caller has
+    // taken out our own pieces, so what is left is a move - and a capture where it lands on an opponent
+    while ( scanForward( &destination, possibleMoves ) )
     {
-        if ( attackingPieces & ( 1ull << closest ) )
+        unsigned long long destinationIndex = 1ull << destination;
+
+        possibleMoves ^= destinationIndex;
+
+        if ( !moveCollator( index, destination, piece | ( ( destinationIndex & attackPieces ) ? Move::CAPTURE : 0 ) ) )
         {
-            return true;
+            return false;
         }
     }
 
-    return false;
+    return true;
 }
 
-// Pass a scanner in here so that we can look either forward or reverse to make sure we check the closest attacker/blocker and
-// don't waste time checking those further away
-bool Board::getDirectionalMoves( const unsigned long& index, const unsigned long piece, const unsigned long long& attackPieces, const unsigned long long& blockingPieces, DirectionMask directionMask, BitScanner bitScanner, MoveCollator moveCollator )
+unsigned long long Board::getAttackers( const unsigned long index, const unsigned long long occupancy ) const
 {
-    unsigned long destination;
+    // Look out from the square as each type of piece - anything of that type we can see is attacking us
+    return ( BitBoard::getWhitePawnAttackMoveMask( index ) & bitboards[ BLACK + PAWN ] ) |
+           ( BitBoard::getBlackPawnAttackMoveMask( index ) & bitboards[ WHITE + PAWN ] ) |
+           ( BitBoard::getKnightMoveMask( index ) & ( bitboards[ WHITE + KNIGHT ] | bitboards[ BLACK + KNIGHT ] ) ) |
+           ( BitBoard::getBishopAttacks( index, occupancy ) & ( bitboards[ WHITE + BISHOP ] | bitboards[ BLACK + BISHOP ] | bitboards[ WHITE + QUEEN ] | bitboards[ BLACK + QUEEN ] ) ) |
+           ( BitBoard::getRookAttacks( index, occupancy ) & ( bitboards[ WHITE + ROOK ] | bitboards[ BLACK + ROOK ] | bitboards[ WHITE + QUEEN ] | bitboards[ BLACK + QUEEN ] ) ) |
+           ( BitBoard::getKingMoveMask( index ) & ( bitboards[ WHITE + KING ] | bitboards[ BLACK + KING ] ) );
+}
 
-    // Get the direction mask (e.g. NorthEast)
-    unsigned long long possibleMoves = directionMask( index );
+void Board::computeAttackMaps() const
+{
+    for ( unsigned short side = WHITE; side <= BLACK; side += BLACK - WHITE )
+    {
+        const unsigned short opponent = side == WHITE ? BLACK : WHITE;
 
-    // Work out the pieces along the way
-    unsigned long long attackersOfInterest = attackPieces & possibleMoves;
-    unsigned long long blockersOfInterest = blockingPieces & possibleMoves;
+        // The opponent's king is taken off the board, so that it can't shelter from a slider behind itself
+        const unsigned long long emptySquares = bitboards[ EMPTY ] | bitboards[ opponent + KING ];
 
-    // For each attacker, clip the path to exclude any steps beyond the attacker
-    if ( bitScanner( &destination, attackersOfInterest ) )
-    {
-        possibleMoves &= ~directionMask( destination );
+        attackMaps[ side == WHITE ? 0 : 1 ] =
+            ( side == WHITE ? BitBoard::getWhitePawnAttackSet( bitboards[ side + PAWN ] ) : BitBoard::getBlackPawnAttackSet( bitboards[ side + PAWN ] ) ) |
+            BitBoard::getKnightAttackSet( bitboards[ side + KNIGHT ] ) |
+            BitBoard::getDiagonalAttackSet( bitboards[ side + BISHOP ] | bitboards[ side + QUEEN ], emptySquares ) |
+            BitBoard::getOrthogonalAttackSet( bitboards[ side + ROOK ] | bitboards[ side + QUEEN ], emptySquares ) |
+            BitBoard::getKingAttackSet( bitboards[ side + KING ] );
     }
 
-    // For each blocker (own piece), clip the path to exclude any steps beyond the blocker (and including the blocker)
-    if ( bitScanner( &destination, blockersOfInterest ) )
+    attackMapsKey = hashKey;
+}
+
+unsigned long long Board::getAttackMapBySquare( bool white ) const
+{
+    const unsigned short side = white ? WHITE : BLACK;
+    const unsigned short opponent = white ? BLACK : WHITE;
+
+    const unsigned long long pieces = bitboards[ side + PAWN ] | bitboards[ side + KNIGHT ] | bitboards[ side + BISHOP ] | bitboards[ side + ROOK ] | bitboards[ side + QUEEN ] | bitboards[ side + KING ];
+    const unsigned long long occupancy = ~bitboards[ EMPTY ] & ~bitboards[ opponent + KING ];
+
+    unsigned long long attacked = 0;
+    for ( unsigned long index = 0; index < 64; index++ )
     {
-        // Add the blocker pieces back in, before we 'not' it, to take out the blocking piece itself
-        possibleMoves &= ~( directionMask( destination ) | blockingPieces );
+        if ( getAttackers( index, occupancy ) & pieces )
+        {
+            attacked |= 1ull << index;
+        }
     }
 
-    // Then create a move for each step along the mask that remains
-    while ( bitScanner( &destination, possibleMoves ) )
+    return attacked;
+}
+
+template <bool WHITE_TO_MOVE>
+bool Board::givesCheck( const unsigned long from, const unsigned long to, const unsigned long extraBits ) const
+{
+    const unsigned short bitboardPieceIndex = WHITE_TO_MOVE ? WHITE : BLACK;
+    const unsigned short opponentPieceIndex = WHITE_TO_MOVE ? BLACK : WHITE;
+
+    const unsigned long long fromBit = 1ull << from;
+    const unsigned long long toBit = 1ull << to;
+
+    unsigned long kingIndex = 0;
+    scanForward( &kingIndex, bitboards[ opponentPieceIndex + KING ] );
+
+    // Build the occupancy and our sliders as they would be after the move
+    unsigned long long occupancy = ( ~bitboards[ EMPTY ] ^ fromBit ) | toBit;
+    unsigned long long diagonalPieces = ( bitboards[ bitboardPieceIndex + BISHOP ] | bitboards[ bitboardPieceIndex + QUEEN ] ) & ~fromBit;
+    unsigned long long crossingPieces = ( bitboards[ bitboardPieceIndex + ROOK ] | bitboards[ bitboardPieceIndex + QUEEN ] ) & ~fromBit;
+
+    if ( ( extraBits & Move::EP_CAPTURE ) == Move::EP_CAPTURE )
     {
-        unsigned long long destinationIndex = 1ull << destination;
+        occupancy ^= WHITE_TO_MOVE ? toBit >> 8 : toBit << 8;
+    }
+    else if ( extraBits & Move::CASTLING_MASK )
+    {
+        // The rook is the only piece that can give check when castling
+        const unsigned long long rookMove = ( extraBits & Move::CASTLING_KSIDE ) ? ( fromBit << 3 ) | ( fromBit << 1 ) : ( fromBit >> 4 ) | ( fromBit >> 1 );
+
+        occupancy ^= rookMove;
+        crossingPieces ^= rookMove;
+    }
 
-        possibleMoves ^= 1ull << destination;
+    // A promoted pawn checks as the piece it becomes
+    const unsigned long promotion = extraBits & Move::PROMOTION_MASK;
+    const unsigned long piece = promotion == Move::QUEEN ? Move::MOVING_QUEEN :
+                                promotion == Move::ROOK ? Move::MOVING_ROOK :
+                                promotion == Move::BISHOP ? Move::MOVING_BISHOP :
+                                promotion == Move::KNIGHT ? Move::MOVING_KNIGHT :
+                                extraBits & Move::MOVING_PIECE;
 
-        if ( !moveCollator( index, destination, piece | ( ( destinationIndex & attackPieces ) ? Move::CAPTURE : 0 ) ) )
+    const unsigned long long kingBit = 1ull << kingIndex;
+    if ( piece == Move::MOVING_PAWN )
+    {
+        if ( ( WHITE_TO_MOVE ? BitBoard::getWhitePawnAttackMoveMask( to ) : BitBoard::getBlackPawnAttackMoveMask( to ) ) & kingBit )
         {
-            return false;
+            return true;
         }
     }
+    else if ( piece == Move::MOVING_KNIGHT )
+    {
+        if ( BitBoard::getKnightMoveMask( to ) & kingBit )
+        {
+            return true;
+        }
+    }
+    else if ( piece == Move::MOVING_BISHOP )
+    {
+        diagonalPieces |= toBit;
+    }
+    else if ( piece == Move::MOVING_ROOK )
+    {
+        crossingPieces |= toBit;
+    }
+    else if ( piece == Move::MOVING_QUEEN )
+    {
+        diagonalPieces |= toBit;
+        crossingPieces |= toBit;
+    }
 
-    return true;
+    // Direct checks from a slider on its new square, and any discovered by the piece moving out of the way
+    return ( BitBoard::getBishopAttacks( kingIndex, occupancy ) & diagonalPieces ) ||
+           ( BitBoard::getRookAttacks( kingIndex, occupancy ) & crossingPieces );
 }
 
 short Board::scorePosition( bool scoreForWhite ) const
 {
-    static const long long pieceWeights[] =
+    // The network scores for the side to move
+    if ( accumulator )
     {
-        100, 310, 320, 500, 900, 10000
-    };
+        const short score = Nnue::evaluate( *accumulator, whiteToMove ? 0 : 1 );
+
+        return scoreForWhite == whiteToMove ? score : -score;
+    }
+
+    // King shelter - a missing pawn in front of a king still on its back two ranks, on its own file or either side of it
+    static const short SHELTER_PENALTY = 15;
+
+    // A passed pawn with something standing in its way
+    static const short BLOCKED_PASSER_PENALTY = 20;
 
-    // For each piece
-    long long score = 0;
-    for ( unsigned short loop = 0; loop < 6; loop++ )
+    // From the attack maps, middlegame then endgame - per square attacked that isn't one of our own pieces, and per
+    // square attacked next to the opponent's king
+    static const short MOBILITY[ 2 ] = { 2, 1 };
+    static const short KING_ZONE[ 2 ] = { 6, 0 };
+
+    static const unsigned long long FILE_A = 0x0101010101010101ull;
+
+    int middlegame = middlegameScore;
+    int endgame = endgameScore;
+
+    // The pawn structure, from the search thread's table if it has one
+    PawnHashTable::Entry scratch;
+    const PawnHashTable::Entry* pawns = &scratch;
+    if ( pawnHashTable )
     {
-#ifdef _WIN32
-        score += pieceWeights[ loop ] * __popcnt64( bitboards[ WHITE + loop ] );
-        score -= pieceWeights[ loop ] * __popcnt64( bitboards[ BLACK + loop ] );
-#elif __linux__
-        score += pieceWeights[ loop ] * _popcnt64( bitboards[ WHITE + loop ] );
-        score -= pieceWeights[ loop ] * _popcnt64( bitboards[ BLACK + loop ] );
-#endif
+        bool found;
+        PawnHashTable::Entry& entry = pawnHashTable->probe( pawnHashKey, found );
+        if ( !found )
+        {
+            scorePawns( entry );
+            entry.key = pawnHashKey;
+        }
+        pawns = &entry;
     }
+    else
+    {
+        scorePawns( scratch );
+    }
+
+    middlegame += pawns->middlegameScore;
+    endgame += pawns->endgameScore;
+
+    // What follows depends on where the other pieces are too, so isn't cached with the pawns
+    for ( unsigned short side = WHITE; side <= BLACK; side += BLACK - WHITE )
+    {
+        const bool white = side == WHITE;
+        const int sign = white ? 1 : -1;
+        const unsigned long long ownPawns = bitboards[ side + PAWN ];
+
+        unsigned long kingIndex = 0;
+        scanForward( &kingIndex, bitboards[ side + KING ] );
+
+        const unsigned short kingRank = static_cast<unsigned short>( kingIndex >> 3 );
+        if ( white ? kingRank <= 1 : kingRank >= 6 )
+        {
+            const unsigned short kingFile = static_cast<unsigned short>( kingIndex & 7 );
+            const unsigned long long shelterRanks = 0xffffull << ( 8 * ( white ? kingRank + 1 : kingRank - 2 ) );
+            for ( int file = std::max( kingFile - 1, 0 ); file <= std::min( kingFile + 1, 7 ); file++ )
+            {
+                if ( !( ownPawns & shelterRanks & ( FILE_A << file ) ) )
+                {
+                    middlegame -= sign * SHELTER_PENALTY;
+                }
+            }
+        }
+
+        const unsigned short opponent = white ? BLACK : WHITE;
+        const unsigned long long ownPieces = ownPawns | bitboards[ side + KNIGHT ] | bitboards[ side + BISHOP ] | bitboards[ side + ROOK ] | bitboards[ side + QUEEN ] | bitboards[ side + KING ];
+        const unsigned long long ownAttacks = getAttackMap( white );
+
+        const int mobility = std::popcount( ownAttacks & ~ownPieces );
+        const int kingZone = std::popcount( ownAttacks & BitBoard::getKingAttackSet( bitboards[ opponent + KING ] ) );
+
+        middlegame += sign * ( MOBILITY[ 0 ] * mobility + KING_ZONE[ 0 ] * kingZone );
+        endgame += sign * ( MOBILITY[ 1 ] * mobility + KING_ZONE[ 1 ] * kingZone );
+
+        unsigned long long passed = pawns->passedPawns & ownPawns;
+        unsigned long index;
+        while ( scanForward( &index, passed ) )
+        {
+            passed ^= 1ull << index;
+
+            const unsigned long long stopSquare = white ? 1ull << ( index + 8 ) : 1ull << ( index - 8 );
+            if ( stopSquare & ~bitboards[ EMPTY ] )
+            {
+                endgame -= sign * BLOCKED_PASSER_PENALTY;
+            }
+        }
+    }
+
+    // Blend the middlegame and endgame totals by how much is left on the board. Promotions can take the phase past
+    // a full board, which is still just middlegame
+    const int middlegamePhase = std::min<int>( phase, PieceSquareTables::MAX_PHASE );
+    const int score = ( middlegame * middlegamePhase + endgame * ( PieceSquareTables::MAX_PHASE - middlegamePhase ) ) / PieceSquareTables::MAX_PHASE;
 
     return static_cast<short>( scoreForWhite ? score : -score );
 }
 
-// TODO make this method const - which also means doing getMoves and children
-// Return only draw (stalemate) or loss (checkmate). Win detection (checkmate) while have previously called this method
-// for the opponent and seen it as a loss
-bool Board::isTerminal( short& score )
+void Board::scorePawns( PawnHashTable::Entry& entry ) const
+{
+    static const short DOUBLED[ 2 ] = { -10, -25 };
+    static const short ISOLATED[ 2 ] = { -5, -15 };
+    static const short BACKWARD[ 2 ] = { -8, -12 };
+
+    // By rank, from the pawn's own side
+    static const short PASSED[ 2 ][ 8 ] = { { 0, 0, 5, 10, 20, 35, 60, 0 }, { 0, 5, 10, 20, 35, 60, 100, 0 } };
+
+    static const unsigned long long FILE_A = 0x0101010101010101ull;
+
+    int middlegame = 0;
+    int endgame = 0;
+    unsigned long long passedPawns = 0;
+
+    for ( unsigned short side = WHITE; side <= BLACK; side += BLACK - WHITE )
+    {
+        const bool white = side == WHITE;
+        const int sign = white ? 1 : -1;
+        const unsigned long long ownPawns = bitboards[ side + PAWN ];
+        const unsigned long long opponentPawns = bitboards[ ( white ? BLACK : WHITE ) + PAWN ];
+
+        unsigned long long pawns = ownPawns;
+        unsigned long index;
+        while ( scanForward( &index, pawns ) )
+        {
+            pawns ^= 1ull << index;
+
+            const unsigned short file = static_cast<unsigned short>( index & 7 );
+            const unsigned short rank = static_cast<unsigned short>( index >> 3 );
+            const unsigned short relativeRank = white ? rank : 7 - rank;
+
+            const unsigned long long fileMask = FILE_A << file;
+            const unsigned long long adjacentFiles = ( file > 0 ? FILE_A << ( file - 1 ) : 0 ) | ( file < 7 ? FILE_A << ( file + 1 ) : 0 );
+
+            // The ranks ahead of the pawn, as it moves, and those level with it or behind
+            const unsigned long long ahead = white ? ~0ull << ( 8 * ( rank + 1 ) ) : ( 1ull << ( 8 * rank ) ) - 1;
+            const unsigned long long notAhead = ~ahead;
+
+            // Counted once for each pawn with another of its own in front of it
+            if ( ownPawns & fileMask & ahead )
+            {
+                middlegame += sign * DOUBLED[ 0 ];
+                endgame += sign * DOUBLED[ 1 ];
+            }
+
+            if ( !( opponentPawns & ( fileMask | adjacentFiles ) & ahead ) )
+            {
+                passedPawns |= 1ull << index;
+                middlegame += sign * PASSED[ 0 ][ relativeRank ];
+                endgame += sign * PASSED[ 1 ][ relativeRank ];
+            }
+
+            if ( !( ownPawns & adjacentFiles ) )
+            {
+                middlegame += sign * ISOLATED[ 0 ];
+                endgame += sign * ISOLATED[ 1 ];
+            }
+            else if ( !( ownPawns & adjacentFiles & notAhead ) && relativeRank < 6 )
+            {
+                // Backward - every neighbour has gone on ahead, so none can come up in support, and an opponent pawn
+                // stops this one from moving up to them
+                const unsigned long stopIndex = white ? index + 8 : index - 8;
+                const unsigned long long stopAttackers = white ? BitBoard::getWhitePawnAttackMoveMask( stopIndex ) : BitBoard::getBlackPawnAttackMoveMask( stopIndex );
+                if ( stopAttackers & opponentPawns )
+                {
+                    middlegame += sign * BACKWARD[ 0 ];
+                    endgame += sign * BACKWARD[ 1 ];
+                }
+            }
+        }
+    }
+
+    entry.passedPawns = passedPawns;
+    entry.middlegameScore = static_cast<short>( middlegame );
+    entry.endgameScore = static_cast<short>( endgame );
+}
+
+bool Board::hasLegalMove() const
 {
     const unsigned short bitboardPieceIndex = whiteToMove ? WHITE : BLACK;
-    const unsigned short opponentPieceIndex = whiteToMove ? BLACK : WHITE;
 
-    bool hasMoves = false;
+    const unsigned long long ownPieces = bitboards[ bitboardPieceIndex + PAWN ] | bitboards[ bitboardPieceIndex + KNIGHT ] | bitboards[ bitboardPieceIndex + BISHOP ] | bitboards[ bitboardPieceIndex + ROOK ] | bitboards[ bitboardPieceIndex + QUEEN ] | bitboards[ bitboardPieceIndex + KING ];
+    const unsigned long long kingBit = bitboards[ bitboardPieceIndex + KING ];
 
-    // This will be called if there are any legal moves in this position
-    auto collator = [&] ( unsigned long from, unsigned long to, unsigned long extraBits = 0 ) -> bool
+    // A king step is the most likely way out, and the cheapest to test - any square the opponent's attack map misses
+    // will do, as the map sees through the king. Castling needn't be tried, as it is only legal when the step alongside is too
+    if ( BitBoard::getKingAttackSet( kingBit ) & ~ownPieces & ~getAttackMap( !whiteToMove ) )
     {
-        hasMoves = true;
+        return true;
+    }
 
-        // We only needed this to be called once - we only want whether or not there are moves, not how
-        // many or what they are
+    // Otherwise any other piece's move will do - the legal generator only offers evasions when in check, and none at
+    // all but the king's when in double check - so stop on the first
+    auto consumer = [] ( const Move& ) -> bool
+    {
         return false;
     };
 
-    getMoves( collator );
+    return whiteToMove ? !getLegalMoves<true, Generation::ALL>( consumer, ~0ull ) : !getLegalMoves<false, Generation::ALL>( consumer, ~0ull );
+}
 
-    if ( !hasMoves )
+bool Board::isTerminal( short& score ) const
+{
+    if ( hasLegalMove() )
     {
-        unsigned long long king = bitboards[ ( whiteToMove ? WHITE : BLACK ) + KING ];
-        if ( isAttacked( king, whiteToMove ) )
-        {
-            score = -1; // activeColor loses - in check with no legal escape
-            return true;
-        }
-        else
-        {
-            score = 0; // stalemate
-            return true;
-        }
+        return false;
     }
 
-    return false;
+    // In check with no legal escape is a loss for the side to move, and otherwise stalemate
+    score = isInCheck() ? -1 : 0;
+
+    return true;
 }
@@ -14,6 +14,11 @@
 #endif
 
 #include "Move.h"
+#include "MoveList.h"
+#include "Nnue.h"
+#include "PawnHashTable.h"
+#include "PieceSquareTables.h"
+#include "Zobrist.h"
 
 class Board
 {
@@ -21,6 +26,18 @@ public:
     typedef std::function<bool( unsigned long, unsigned long, unsigned long )> MoveCollator;
 
 private:
+    /// <summary>
+    /// Which of the legal moves to generate. CAPTURES and QUIETS split ALL between them, so that a search can generate
+    /// the captures first and only go on to the quiet moves if it needs them
+    /// </summary>
+    enum class Generation
+    {
+        ALL,        // Every legal move
+        QUIESCENT,  // Captures, promotions and checks - or every legal move, when in check
+        CAPTURES,   // Captures (including en passant) and promotions
+        QUIETS      // Everything else, including castling
+    };
+
     static const unsigned short EMPTY;
     static const unsigned short WHITE;
     static const unsigned short BLACK;
@@ -32,6 +49,9 @@ private:
     static const unsigned short QUEEN;
     static const unsigned short KING;
 
+    // Material values, indexed by piece (PAWN to KING)
+    static const short PIECE_VALUES[ 6 ];
+
     // Lucky 13 - empty, 6 white pieces, 6 black pieces
     std::array<unsigned long long, 13> bitboards;
 
@@ -44,6 +64,38 @@ private:
     unsigned short halfMoveClock;
     unsigned short fullMoveNumber;
 
+    // Zobrist key for the position, maintained incrementally as moves are applied
+    unsigned long long hashKey;
+
+    // Zobrist key of the pawns alone, maintained the same way, for the pawn hash table
+    unsigned long long pawnHashKey;
+
+    // Piece-square table totals, material included, for the middlegame and the endgame from white's point of view, and
+    // the game phase from the pieces left - all maintained incrementally, like the key
+    short middlegameScore;
+    short endgameScore;
+    short phase;
+
+    // Where the search thread using this board caches pawn structure scores, or null to work them out every time
+    PawnHashTable* pawnHashTable;
+
+    // Every square attacked by white, then by black, worked out when first asked for and kept for as long as the
+    // position key is the one they were worked out for - so the legality checks and the evaluation at a node share them
+    mutable std::array<unsigned long long, 2> attackMaps;
+    mutable unsigned long long attackMapsKey;
+
+    // Where the network's first layer output is kept, one accumulator for each ply from the search root, or null to
+    // evaluate without the network. A move works out the next accumulator along from the current one, so unmaking it
+    // only has to step back
+    Nnue::Accumulator* accumulator;
+    Nnue::Accumulator* accumulatorEnd;
+
+    // Pieces put on and taken off the board by the move being applied, for updating the accumulator once it is done
+    std::array<Nnue::Change, 4> addedPieces;
+    std::array<Nnue::Change, 4> removedPieces;
+    unsigned short addedCount;
+    unsigned short removedCount;
+
     Board( std::array<unsigned long long, 13> bitboards,
            bool whiteToMove,
            std::array<bool, 4> castlingRights,
@@ -55,7 +107,21 @@ private:
         castlingRights( castlingRights ),
         enPassantIndex( enPassantIndex ),
         halfMoveClock( halfMoveClock ),
-        fullMoveNumber( fullMoveNumber )
+        fullMoveNumber( fullMoveNumber ),
+        hashKey( 0 ),
+        pawnHashKey( 0 ),
+        middlegameScore( 0 ),
+        endgameScore( 0 ),
+        phase( 0 ),
+        pawnHashTable( nullptr ),
+        attackMaps( { 0, 0 } ),
+        attackMapsKey( 0 ),
+        accumulator( nullptr ),
+        accumulatorEnd( nullptr ),
+        addedPieces(),
+        removedPieces(),
+        addedCount( 0 ),
+        removedCount( 0 )
     {
     }
 
@@ -107,6 +173,20 @@ private:
     {
         bitboards[ piece ] ^= ( from | to );
         bitboards[ EMPTY ] ^= ( from | to );
+
+        const unsigned long fromIndex = squareFromBit( from );
+        const unsigned long toIndex = squareFromBit( to );
+        hashKey ^= Zobrist::getPieceKey( piece, fromIndex ) ^ Zobrist::getPieceKey( piece, toIndex );
+        pawnHashKey ^= Zobrist::getPawnKey( piece, fromIndex ) ^ Zobrist::getPawnKey( piece, toIndex );
+
+        middlegameScore += PieceSquareTables::getMiddlegameValue( piece, toIndex ) - PieceSquareTables::getMiddlegameValue( piece, fromIndex );
+        endgameScore += PieceSquareTables::getEndgameValue( piece, toIndex ) - PieceSquareTables::getEndgameValue( piece, fromIndex );
+
+        if ( accumulator )
+        {
+            removedPieces[ removedCount++ ] = { piece, fromIndex };
+            addedPieces[ addedCount++ ] = { piece, toIndex };
+        }
     }
 
     /// <summary>
@@ -118,6 +198,19 @@ private:
     {
         bitboards[ piece ] ^= location;
         bitboards[ EMPTY ] ^= location;
+
+        const unsigned long index = squareFromBit( location );
+        hashKey ^= Zobrist::getPieceKey( piece, index );
+        pawnHashKey ^= Zobrist::getPawnKey( piece, index );
+
+        middlegameScore -= PieceSquareTables::getMiddlegameValue( piece, index );
+        endgameScore -= PieceSquareTables::getEndgameValue( piece, index );
+        phase -= PieceSquareTables::getPhaseWeight( piece );
+
+        if ( accumulator )
+        {
+            removedPieces[ removedCount++ ] = { piece, index };
+        }
     }
 
     /// <summary>
@@ -131,24 +224,121 @@ private:
         // Put the piece into its new location and remove whatever was there from its boards (includes EMPTY)
         bitboards[ piece ] ^= location;
         bitboards[ replacingPiece ] ^= location;
+
+        // The key for EMPTY is zero, so this is harmless if there is no capture
+        const unsigned long index = squareFromBit( location );
+        hashKey ^= Zobrist::getPieceKey( piece, index ) ^ Zobrist::getPieceKey( replacingPiece, index );
+        pawnHashKey ^= Zobrist::getPawnKey( piece, index ) ^ Zobrist::getPawnKey( replacingPiece, index );
+
+        // Likewise the values for EMPTY
+        middlegameScore += PieceSquareTables::getMiddlegameValue( piece, index ) - PieceSquareTables::getMiddlegameValue( replacingPiece, index );
+        endgameScore += PieceSquareTables::getEndgameValue( piece, index ) - PieceSquareTables::getEndgameValue( replacingPiece, index );
+        phase += PieceSquareTables::getPhaseWeight( piece ) - PieceSquareTables::getPhaseWeight( replacingPiece );
+
+        if ( accumulator )
+        {
+            addedPieces[ addedCount++ ] = { piece, index };
+            if ( replacingPiece != EMPTY )
+            {
+                removedPieces[ removedCount++ ] = { replacingPiece, index };
+            }
+        }
     }
 
-    bool getPawnMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, MoveCollator moveCollator );
-    bool getKnightMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, MoveCollator moveCollator );
-    bool getBishopMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces, MoveCollator moveCollator );
-    bool getRookMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces, MoveCollator moveCollator );
-    bool getQueenMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces, MoveCollator moveCollator );
-    bool getKingMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, MoveCollator moveCollator );
+    /// <summary>
+    /// Square index of a single-bit mask
+    /// </summary>
+    /// <param name="bit">a mask with exactly one bit set</param>
+    /// <returns></returns>
+    inline static unsigned long squareFromBit( unsigned long long bit )
+    {
+        unsigned long index = 0;
+        scanForward( &index, bit );
+        return index;
+    }
+
+    // The generator is specialised on the side to move and on the collator type, so the collator can be
+    // inlined into the bitboard loops rather than being called through a std::function
+    template <bool WHITE_TO_MOVE, typename Collator>
+    bool getPawnMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& captureSquares, Collator& moveCollator ) const;
+    template <typename Collator>
+    bool getKnightMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, Collator& moveCollator ) const;
+    template <typename Collator>
+    bool getBishopMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, Collator& moveCollator ) const;
+    template <typename Collator>
+    bool getRookMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, Collator& moveCollator ) const;
+    template <typename Collator>
+    bool getQueenMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, Collator& moveCollator ) const;
+    template <bool WHITE_TO_MOVE, Generation GENERATION, typename Collator>
+    bool getKingMoves( const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, Collator& moveCollator ) const;
 
     /// <summary>
     /// Returns true if any square indicated in the mask is attacked by the current opponent
     /// </summary>
     /// <param name="mask">bit or bits to test</param>
     /// <returns>true if the opponent is currently attacking any of these squares</returns>
-    bool isAttacked( unsigned long long mask, bool asWhite );
+    bool isAttacked( unsigned long long mask, bool asWhite ) const;
 
-    typedef unsigned long long ( *DirectionMask )( const unsigned long );
-    typedef unsigned char ( *BitScanner )( unsigned long*, unsigned long long );
+    /// <summary>
+    /// Returns all pieces, of either colour, that attack a square given a board occupancy.
+    /// The occupancy can be hypothetical, e.g. with a piece lifted off, to see what would attack the square after a move
+    /// </summary>
+    /// <param name="index">the square of interest</param>
+    /// <param name="occupancy">occupied squares, used to block the sliders</param>
+    /// <returns>the squares of the attacking pieces</returns>
+    unsigned long long getAttackers( const unsigned long index, const unsigned long long occupancy ) const;
+
+    /// <summary>
+    /// The Move bits for capturing whatever is on a square
+    /// </summary>
+    /// <param name="location">location bit of the piece being captured</param>
+    /// <returns>one of Move::CAPTURE_PAWN to Move::CAPTURE_KING, or zero if the square is empty</returns>
+    inline unsigned long capturePieceBits( unsigned long long location ) const
+    {
+        static const unsigned long captureBits[] = { Move::CAPTURE_PAWN, Move::CAPTURE_KNIGHT, Move::CAPTURE_BISHOP, Move::CAPTURE_ROOK, Move::CAPTURE_QUEEN, Move::CAPTURE_KING };
+
+        for ( unsigned short piece = PAWN; piece <= KING; piece++ )
+        {
+            if ( ( bitboards[ WHITE + piece ] | bitboards[ BLACK + piece ] ) & location )
+            {
+                return captureBits[ piece ];
+            }
+        }
+
+        return 0;
+    }
+
+    /// <summary>
+    /// Works out whether a legal move would put the opponent in check, directly or by discovery, without making the move
+    /// </summary>
+    /// <returns>true if the move gives check</returns>
+    template <bool WHITE_TO_MOVE>
+    bool givesCheck( const unsigned long from, const unsigned long to, const unsigned long extraBits ) const;
+
+    /// <summary>
+    /// Generates pseudo-legal moves for all pieces, restricting non-king pieces to a set of destinations.
+    /// For QUIESCENT, quiet moves are only generated where they might give check, and castling not at all
+    /// </summary>
+    /// <param name="moveCollator">where to send each move</param>
+    /// <param name="targetSquares">squares that knights and sliders may move to (e.g. to block or capture a checker)</param>
+    /// <returns>false if the collator asked for generation to stop</returns>
+    template <bool WHITE_TO_MOVE, Generation GENERATION, typename Collator>
+    bool generateMoves( Collator& moveCollator, const unsigned long long& targetSquares ) const;
+
+    /// <summary>
+    /// Generates legal moves, passing each to a consumer
+    /// </summary>
+    /// <param name="consumer">called with each move, returning false to stop generation</param>
+    /// <param name="targetSquares">squares that pieces other than the king may move to - anything else is skipped</param>
+    /// <returns>false if the consumer asked for generation to stop</returns>
+    template <bool WHITE_TO_MOVE, Generation GENERATION, typename Consumer>
+    bool getLegalMoves( Consumer& consumer, const unsigned long long& targetSquares ) const;
+
+    /// <summary>
+    /// Generates legal moves into a list
+    /// </summary>
+    template <Generation GENERATION>
+    bool getLegalMoves( MoveList& moves ) const;
 
     inline static unsigned char scanForward( unsigned long* index, unsigned long long mask )
     {
@@ -180,18 +370,190 @@ private:
 #endif
     }
 
-    bool getDirectionalMoves( const unsigned long& index, const unsigned long piece, const unsigned long long& attackPieces, const unsigned long long& blockingPieces, DirectionMask directionMask, BitScanner bitScanner, MoveCollator moveCollator );
-    bool isAttacked( const unsigned long& index, const unsigned long long& attackingPieces, DirectionMask directionMask, BitScanner bitScanner );
+    /// <summary>
+    /// Work out one perspective of an accumulator from scratch, from the pieces on the board
+    /// </summary>
+    /// <param name="target">the accumulator</param>
+    /// <param name="perspective">0 for white's point of view, 1 for black's</param>
+    void refreshAccumulator( Nnue::Accumulator& target, unsigned short perspective ) const;
+
+    /// <summary>
+    /// Step on to the next accumulator and work it out from the current one, from the pieces the move just applied put
+    /// on and took off the board. A side whose king moved needs its perspective working out from scratch instead
+    /// </summary>
+    void updateAccumulator();
+
+    /// <summary>
+    /// Score the pawn structure - doubled, isolated, backward and passed pawns - and find the passed pawns. Only the
+    /// pawns are looked at, so the result can be cached against the pawn key
+    /// </summary>
+    /// <param name="entry">where to put the scores and passed pawns</param>
+    void scorePawns( PawnHashTable::Entry& entry ) const;
+
+    template <typename Collator>
+    bool getSlidingMoves( const unsigned long& index, const unsigned long piece, unsigned long long possibleMoves, const unsigned long long& attackPieces, Collator& moveCollator ) const;
 
 public:
     static Board* createBoard( const std::string& fen );
 
     std::string toString() const;
 
-    bool getMoves( std::vector<Move>& moves );
-    bool getMoves( MoveCollator moveCollator );
+    /// <summary>
+    /// Calculate the Zobrist key for the position from scratch.
+    /// Normally only needed when creating a board - after that, the key is maintained incrementally
+    /// </summary>
+    /// <returns></returns>
+    unsigned long long computeHashKey() const;
 
-    void sortMoves( std::vector<Move>& moves );
+    inline unsigned long long getHashKey() const
+    {
+        return hashKey;
+    }
+
+    /// <summary>
+    /// Calculate the Zobrist key of the pawns alone from scratch. Like the position key, only needed when creating a board
+    /// </summary>
+    unsigned long long computePawnHashKey() const;
+
+    inline unsigned long long getPawnHashKey() const
+    {
+        return pawnHashKey;
+    }
+
+    /// <summary>
+    /// Cache pawn structure scores in a table from now on - the table of the search thread this board belongs to
+    /// </summary>
+    /// <param name="table">the table, or null to work the scores out every time</param>
+    inline void setPawnHashTable( PawnHashTable* table )
+    {
+        pawnHashTable = table;
+    }
+
+    /// <summary>
+    /// Evaluate with the network from now on, keeping its accumulators in a range belonging to the search thread this
+    /// board belongs to. The first is worked out for the position now; moves take up one more each. Should moves go
+    /// past the end, the evaluation falls back to the hand-written one until they are unmade
+    /// </summary>
+    /// <param name="first">the first accumulator, or null to evaluate without the network</param>
+    /// <param name="last">one past the last accumulator</param>
+    void setAccumulators( Nnue::Accumulator* first, Nnue::Accumulator* last );
+
+    /// <summary>
+    /// Work out the piece-square table totals and game phase from scratch. Like the key, only needed when creating a
+    /// board - after that, they are maintained incrementally
+    /// </summary>
+    void computePieceSquareScores();
+
+    /// <summary>
+    /// Generates all legal moves for the side to move. Checkers, the squares that deal with a check and any pinned pieces
+    /// are worked out once for the position, so moves are never made and unmade just to see whether they are legal
+    /// </summary>
+    /// <param name="moves">the list to add moves to</param>
+    /// <returns>true, always</returns>
+    bool getMoves( MoveList& moves ) const;
+
+    /// <summary>
+    /// The original generator - pseudo-legal moves, each made, tested for leaving the king in check and unmade.
+    /// Much slower than getMoves, but kept as an independent reference for perft to check the legal generator against
+    /// </summary>
+    /// <param name="moves">the list to add moves to</param>
+    /// <returns>true, always</returns>
+    bool getMovesLegacy( MoveList& moves );
+
+    /// <summary>
+    /// Generates the legal moves for quiescence - captures (including en passant), promotions and checks. Quiet moves
+    /// that can't give check are never generated. When in check, every legal move is an evasion and worth looking at,
+    /// so all of them are generated instead
+    /// </summary>
+    /// <param name="moves">the list to add moves to</param>
+    /// <returns>true, always</returns>
+    bool getQuiescentMoves( MoveList& moves ) const;
+
+    /// <summary>
+    /// Generates the legal captures (including en passant) and promotions. With getQuietMoves, this makes up getMoves
+    /// </summary>
+    /// <param name="moves">the list to add moves to</param>
+    /// <returns>true, always</returns>
+    bool getCaptures( MoveList& moves ) const;
+
+    /// <summary>
+    /// Generates the legal moves that neither capture nor promote, including castling
+    /// </summary>
+    /// <param name="moves">the list to add moves to</param>
+    /// <returns>true, always</returns>
+    bool getQuietMoves( MoveList& moves ) const;
+
+    /// <summary>
+    /// Checks whether a move from elsewhere - the transposition table, or a killer from another node - is legal in this
+    /// position, without generating every move. Such a move may only have its from, to and promotion set, so the rest
+    /// of its flags are filled in as the generator would have set them
+    /// </summary>
+    /// <param name="move">the move to check, completed if it is legal</param>
+    /// <returns>true if the move is legal</returns>
+    bool validateMove( Move& move ) const;
+
+    /// <summary>
+    /// Whether the side to move is in check
+    /// </summary>
+    bool isInCheck() const;
+
+    /// <summary>
+    /// Work out both sides' attack maps set-wise, and note the position key they are for. getAttackMap does this when it
+    /// needs to, so this is only worth calling directly to time it
+    /// </summary>
+    void computeAttackMaps() const;
+
+    /// <summary>
+    /// Every square attacked by one side, from the cache if the position hasn't changed since it was worked out. Sliders
+    /// see through the other side's king, so a square the king would step back into along a ray still counts as
+    /// attacked - which makes the map exactly the squares that king can't move to
+    /// </summary>
+    /// <param name="white">true for the squares white attacks</param>
+    /// <returns>the attacked squares</returns>
+    inline unsigned long long getAttackMap( bool white ) const
+    {
+        if ( attackMapsKey != hashKey )
+        {
+            computeAttackMaps();
+        }
+
+        return attackMaps[ white ? 0 : 1 ];
+    }
+
+    /// <summary>
+    /// The same map as getAttackMap, worked out the old way - one square at a time, looking out from each for attackers.
+    /// Much slower, but kept as an independent reference to check the set-wise maps against and to time them by
+    /// </summary>
+    /// <param name="white">true for the squares white attacks</param>
+    /// <returns>the attacked squares</returns>
+    unsigned long long getAttackMapBySquare( bool white ) const;
+
+    bool getMoves( MoveCollator moveCollator ) const;
+
+    /// <summary>
+    /// Score moves for ordering. Captures and promotions that don't lose material come first, from 1 << 28, by most
+    /// valuable victim and then least valuable attacker. Then the other moves, below 1 << 24, checks and check evasions
+    /// first. Captures that lose material come last, with a negative score - so quiescence can pass them over
+    /// </summary>
+    /// <param name="moves">the moves to score</param>
+    /// <param name="first">the first of the moves to score, so that moves added to a list can be scored on their own</param>
+    void scoreMoves( MoveList& moves, size_t first = 0 ) const;
+
+    /// <summary>
+    /// Score moves, as scoreMoves, and sort them best first
+    /// </summary>
+    /// <param name="moves">the moves, scored and sorted in place</param>
+    void sortMoves( MoveList& moves ) const;
+
+    /// <summary>
+    /// Static exchange evaluation - the material the side to move expects to win, or lose, by making a capture and then
+    /// letting both sides take turns to recapture on that square with their least valuable piece, each stopping
+    /// whenever it would be better off not carrying on. Pieces revealed behind others, such as a rook behind a
+    /// queen, join in as the pieces in front of them are used up
+    /// </summary>
+    /// <param name="move">a capture or promotion for the side to move</param>
+    /// <returns>the expected gain in centipawns, negative for a loss</returns>
+    short staticExchange( const Move& move ) const;
 
     class State
     {
@@ -202,6 +564,14 @@ public:
         unsigned long long enPassantIndex;
         unsigned short halfMoveClock;
         unsigned short fullMoveNumber;
+        unsigned long long hashKey;
+        unsigned long long pawnHashKey;
+        short middlegameScore;
+        short endgameScore;
+        short phase;
+        std::array<unsigned long long, 2> attackMaps;
+        unsigned long long attackMapsKey;
+        Nnue::Accumulator* accumulator;
 
     public:
         State( const Board* board );
@@ -216,8 +586,34 @@ public:
 
     void applyMove( const Move& move );
 
+    /// <summary>
+    /// Pass - hand the move to the opponent without moving anything, for null move pruning. Undo this with unmakeMove,
+    /// from a state taken before it
+    /// </summary>
+    void applyNullMove();
+
+    /// <summary>
+    /// Whether the side to move has anything other than pawns and the king. Without, zugzwang is common enough that
+    /// passing can't be relied on to be the worst option
+    /// </summary>
+    bool hasNonPawnMaterial() const;
+
     short scorePosition( bool scoreForWhite ) const;
-    bool isTerminal( short& score );
+
+    /// <summary>
+    /// Whether the side to move has any legal move at all. King moves are tried first, then the rest of the moves
+    /// (only the evasions when in check) until one turns up - nothing is collected, so nothing is allocated
+    /// </summary>
+    /// <returns>true if there is a legal move</returns>
+    bool hasLegalMove() const;
+
+    /// <summary>
+    /// Whether the game is over, by checkmate or stalemate. The search doesn't need this, as it finds out from the moves
+    /// it generates anyway
+    /// </summary>
+    /// <param name="score">set to -1 if the side to move is checkmated, or 0 for stalemate</param>
+    /// <returns>true if the side to move has no legal moves</returns>
+    bool isTerminal( short& score ) const;
 
     inline bool whiteToPlay() const
     {
@@ -2,21 +2,28 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdarg>
 #include <fstream>
+#include <iomanip>
 #include <istream>
 #include <iostream>
 #include <limits>
 #include <sstream>
 #include <string>
 
+#include "Allocations.h"
+#include "Bench.h"
 #include "BitBoard.h"
 #include "Fen.h"
 #include "GoArguments.h"
 #include "Move.h"
+#include "MovePicker.h"
 #include "Perft.h"
+#include "PieceSquareTables.h"
 #include "Test.h"
 #include "Version.h"
+#include "Zobrist.h"
 
 #undef SHOW_LINES
 #undef QUIESCE
@@ -39,6 +46,15 @@
 #define WARN(...) { log( Engine::LogLevel::WARN, __VA_ARGS__ ); }
 #define ERROR(...) { log( Engine::LogLevel::ERROR, __VA_ARGS__ ); }
 
+const short Engine::MATE_SCORE = 32000;
+const short Engine::MATE_THRESHOLD = Engine::MATE_SCORE - 1000;
+const short Engine::INFINITE_SCORE = std::numeric_limits<short>::max();
+
+const unsigned int Engine::DEFAULT_THREADS = 1;
+const unsigned int Engine::MAX_THREADS = 256;
+
+const char* Engine::DEFAULT_EVAL_FILE = "motive.nnue";
+
 std::map<const std::string, Engine::CommandHandler> Engine::commandHandlers
 {
     // Standard UCI commands
@@ -58,6 +74,8 @@ std::map<const std::string, Engine::CommandHandler> Engine::commandHandlers
     { "perft", &Engine::perftCommand },
     { "test", &Engine::testCommand },
     { "wait", &Engine::waitCommand },
+    { "bench", &Engine::benchCommand },
+    { "stoplatency", &Engine::stoplatencyCommand },
 };
 
 Engine::Engine() :
@@ -75,6 +93,11 @@ Engine::Engine() :
     logStream( nullptr ),
     stagedPosition( Fen::startingPositionReference ),
     stopThinking( false ),
+    threads( DEFAULT_THREADS ),
+    nullMovePruning( true ),
+    lateMoveReductions( true ),
+    futilityPruning( true ),
+    networkEvaluation( true ),
     currentSearch( nullptr )
 {
 }
@@ -104,6 +127,18 @@ void Engine::initialize()
     DEBUG( "initialize" );
 
     BitBoard::initialize();
+    Zobrist::initialize();
+    PieceSquareTables::initialize();
+
+    // Evaluate with a network if there is one to hand, and with the hand-written evaluation if not
+    if ( Nnue::load( DEFAULT_EVAL_FILE ) )
+    {
+        INFO( "Loaded network: %s", DEFAULT_EVAL_FILE );
+    }
+    else
+    {
+        INFO( "No network loaded from %s", DEFAULT_EVAL_FILE );
+    }
 }
 
 void Engine::run()
@@ -124,7 +159,7 @@ void Engine::run()
 
     // Read, line by line until the end or 'quitting' is set
     std::string line;
-    while ( !quitting && std::getline( instream, line ) )
+    while ( !quitting.load( std::memory_order_relaxed ) && std::getline( instream, line ) )
     {
         line = trim( line );
 
@@ -171,8 +206,14 @@ void Engine::uciCommand( Engine& engine, const std::string& arguments )
     engine.copyprotectionBroadcast( CopyProtection::Status::CHECKING );
     engine.copyprotectionBroadcast( CopyProtection::Status::OK );
 
-    // TODO if we ever have more than one option, handle them in a better way than this
     engine.optionBroadcast( "Trace", engine.debug );
+    engine.optionBroadcast( "Hash", static_cast<int>( TranspositionTable::DEFAULT_SIZE_MB ), static_cast<int>( TranspositionTable::MIN_SIZE_MB ), static_cast<int>( TranspositionTable::MAX_SIZE_MB ) );
+    engine.optionBroadcast( "Threads", static_cast<int>( DEFAULT_THREADS ), 1, static_cast<int>( MAX_THREADS ) );
+    engine.optionBroadcast( "NullMove", engine.nullMovePruning );
+    engine.optionBroadcast( "LMR", engine.lateMoveReductions );
+    engine.optionBroadcast( "Futility", engine.futilityPruning );
+    engine.optionBroadcast( "UseNNUE", engine.networkEvaluation );
+    engine.optionBroadcast( "EvalFile", Nnue::isLoaded() ? Nnue::getLoadedFile() : DEFAULT_EVAL_FILE );
 
     engine.uciokBroadcast();
 
@@ -218,44 +259,120 @@ void Engine::setoptionCommand( Engine& engine, const std::string& arguments )
     INFO_S( engine, "Processing setoption command" );
 
     std::pair<std::string, std::string> details = firstWord( arguments );
-    if ( details.first == "name" )
+    if ( details.first != "name" )
+    {
+        ERROR_S( engine, "Malformed setoption command. Expected 'name'" );
+        return;
+    }
+
+    // The option name may contain spaces, so collect everything up to 'value'
+    std::stringstream nameStream;
+    details = firstWord( details.second );
+    while ( !details.first.empty() && details.first != "value" )
     {
+        if ( !nameStream.str().empty() )
+        {
+            nameStream << " ";
+        }
+        nameStream << details.first;
+
         details = firstWord( details.second );
-        if ( details.first == "Trace" )
+    }
+
+    const std::string name = nameStream.str();
+    if ( details.first != "value" )
+    {
+        ERROR_S( engine, "Malformed setoption command. Expected 'value'" );
+        return;
+    }
+    if ( details.second.empty() )
+    {
+        ERROR_S( engine, "Missing value for setoption" );
+        return;
+    }
+
+    const std::string& value = details.second;
+    if ( name == "Trace" )
+    {
+        if ( value == "true" )
         {
-            details = firstWord( details.second );
-            if ( details.first == "value" )
-            {
-                if ( details.second == "true" )
-                {
-                    engine.debug = true;
-                }
-                else if ( details.second == "false" )
-                {
-                    engine.debug = false;
-                }
-                else if ( details.second.empty() )
-                {
-                    ERROR_S( engine, "Missing value for setoption" );
-                }
-                else
-                {
-                    ERROR_S( engine, "Illegal value for setoption: %s", details.second.c_str() );
-                }
-            }
-            else
-            {
-                ERROR_S( engine, "Malformed setoption command. Expected 'value'" );
-            }
+            engine.debug = true;
+        }
+        else if ( value == "false" )
+        {
+            engine.debug = false;
+        }
+        else
+        {
+            ERROR_S( engine, "Illegal value for setoption: %s", value.c_str() );
+        }
+    }
+    else if ( name == "Hash" )
+    {
+        int megabytes = atoi( value.c_str() );
+        if ( megabytes < static_cast<int>( TranspositionTable::MIN_SIZE_MB ) || megabytes > static_cast<int>( TranspositionTable::MAX_SIZE_MB ) )
+        {
+            ERROR_S( engine, "Illegal value for setoption: %s", value.c_str() );
+        }
+        else
+        {
+            // Not something we can do while a search is using the table
+            engine.stopImpl();
+            engine.transpositionTable.resize( megabytes );
+
+            DEBUG_S( engine, "Transposition table resized to %d bytes", engine.transpositionTable.size() );
+        }
+    }
+    else if ( name == "Threads" )
+    {
+        int threads = atoi( value.c_str() );
+        if ( threads < 1 || threads > static_cast<int>( MAX_THREADS ) )
+        {
+            ERROR_S( engine, "Illegal value for setoption: %s", value.c_str() );
+        }
+        else
+        {
+            // Get the threads ready now, rather than when the next search starts
+            engine.stopImpl();
+            engine.threads = threads;
+            engine.prepareThreads( engine.threads );
+
+            DEBUG_S( engine, "Searching with %d thread(s)", engine.threads );
+        }
+    }
+    else if ( name == "EvalFile" )
+    {
+        // Not something we can do while a search is using the network
+        engine.stopImpl();
+
+        if ( Nnue::load( value ) )
+        {
+            DEBUG_S( engine, "Loaded network: %s", value.c_str() );
+        }
+        else
+        {
+            ERROR_S( engine, "Failed to load network: %s", value.c_str() );
+        }
+    }
+    else if ( name == "NullMove" || name == "LMR" || name == "Futility" || name == "UseNNUE" )
+    {
+        bool& option = name == "NullMove" ? engine.nullMovePruning : name == "LMR" ? engine.lateMoveReductions : name == "Futility" ? engine.futilityPruning : engine.networkEvaluation;
+        if ( value == "true" )
+        {
+            option = true;
+        }
+        else if ( value == "false" )
+        {
+            option = false;
         }
         else
         {
-            ERROR_S( engine, "Unrecognised option name: %s", details.first.c_str() );
+            ERROR_S( engine, "Illegal value for setoption: %s", value.c_str() );
         }
     }
     else
     {
-        ERROR_S( engine, "Malformed setoption command. Expected 'name'" );
+        ERROR_S( engine, "Unrecognised option name: %s", name.c_str() );
     }
 }
 
@@ -319,6 +436,13 @@ void Engine::ucinewgameCommand( Engine& engine, const std::string& arguments )
     INFO_S( engine, "Processing ucinewgame command" );
 
     engine.resetGame( engine );
+
+    // Nothing from a previous game is likely to be of use
+    engine.transpositionTable.clear();
+    for ( std::unique_ptr<ThreadData>& data : engine.threadData )
+    {
+        data->moveOrdering->clear();
+    }
 }
 
 void Engine::positionCommand( Engine& engine, const std::string& arguments )
@@ -522,7 +646,7 @@ void Engine::goCommand( Engine& engine, const std::string& arguments )
     // Interrupt any current search
     engine.stopImpl();
 
-    engine.currentSearch = new Search( *board, goArgs );
+    engine.currentSearch = new Search( *board, goArgs, engine.threads );
     engine.currentSearch->run( &engine ); 
 }
 
@@ -544,7 +668,7 @@ void Engine::quitCommand( Engine& engine, const std::string& arguments )
 {
     INFO_S( engine, "Processing quit command" );
 
-    engine.quitting = true;
+    engine.quitting.store( true, std::memory_order_relaxed );
 
     engine.stopImpl();
 }
@@ -554,6 +678,7 @@ void Engine::perftCommand( Engine& engine, const std::string& arguments )
     INFO_S( engine, "Processing perft command" );
 
     bool divide = false;
+    Perft::Generator generator = Perft::Generator::LEGAL;
 
     // Types of perft:
     //  [depth]
@@ -562,6 +687,8 @@ void Engine::perftCommand( Engine& engine, const std::string& arguments )
     //  file [epd file]
     // 
     // Optionally, can be run with 'divide' as first arg
+    // Optionally, can then be given 'legacy' to count with the old make/unmake move generator, or 'crosscheck'
+    // to run both generators at every node and report any differences
 
     std::pair<std::string, std::string> commandArguments = firstWord( arguments );
 
@@ -580,11 +707,26 @@ void Engine::perftCommand( Engine& engine, const std::string& arguments )
         commandArguments = firstWord( commandArguments.second );
     }
 
+    if ( commandArguments.first == "legacy" )
+    {
+        DEBUG_S( engine, "Performing perft with the legacy move generator" );
+
+        generator = Perft::Generator::LEGACY;
+        commandArguments = firstWord( commandArguments.second );
+    }
+    else if ( commandArguments.first == "crosscheck" )
+    {
+        DEBUG_S( engine, "Performing perft cross-checking the move generators" );
+
+        generator = Perft::Generator::CROSSCHECK;
+        commandArguments = firstWord( commandArguments.second );
+    }
+
     if ( commandArguments.first == "file" )
     {
         if ( !commandArguments.second.empty() )
         {
-            engine.perftFile( commandArguments.second, divide );
+            engine.perftFile( commandArguments.second, divide, generator );
         }
         else
         {
@@ -595,7 +737,7 @@ void Engine::perftCommand( Engine& engine, const std::string& arguments )
     {
         if ( !commandArguments.second.empty() )
         {
-            engine.perftFen( commandArguments.second, divide );
+            engine.perftFen( commandArguments.second, divide, generator );
         }
         else
         {
@@ -607,12 +749,12 @@ void Engine::perftCommand( Engine& engine, const std::string& arguments )
         if ( commandArguments.second.empty() )
         {
             // Assume "perft [depth]"
-            engine.perftDepth( commandArguments.first, Fen::startingPosition, divide );
+            engine.perftDepth( commandArguments.first, Fen::startingPosition, divide, generator );
         }
         else
         {
             // Assume "perft [depth] [fen]"
-            engine.perftDepth( commandArguments.first, commandArguments.second, divide );
+            engine.perftDepth( commandArguments.first, commandArguments.second, divide, generator );
         }
     }
 }
@@ -663,6 +805,234 @@ void Engine::waitCommand( Engine& engine, const std::string& arguments )
     engine.waitImpl();
 }
 
+void Engine::benchCommand( Engine& engine, const std::string& arguments )
+{
+    INFO_S( engine, "Processing bench command" );
+
+    // Types of bench:
+    //  tt [threads] [iterations] - transposition table stress test
+    //  time [games] [time] [increment] - self-play on a clock, reporting time losses and time used per move
+    //  smp filename [depth] - time to depth for increasing numbers of threads, e.g. on test/speedtests.txt
+    //  go [count] - latency of many short searches, on the search thread pool and on a new thread each time
+    //  depth [depth] - nodes and time to search a built-in set of positions to a fixed depth
+    //  attacks [iterations] - time to work out both sides' attack maps set-wise and square by square
+    //  nnue [depth] - the built-in positions searched to a fixed depth with and without the network, side by side
+
+    std::pair<std::string, std::string> commandArguments = firstWord( arguments );
+
+    if ( commandArguments.first == "tt" )
+    {
+        commandArguments = firstWord( commandArguments.second );
+        int threads = commandArguments.first.empty() ? std::thread::hardware_concurrency() : atoi( commandArguments.first.c_str() );
+
+        commandArguments = firstWord( commandArguments.second );
+        int iterations = commandArguments.first.empty() ? 10000000 : atoi( commandArguments.first.c_str() );
+
+        if ( threads < 1 || iterations < 1 )
+        {
+            ERROR_S( engine, "Illegal bench arguments: %s", arguments.c_str() );
+            return;
+        }
+
+        Bench::transpositionTableStress( engine, threads, iterations );
+    }
+    else if ( commandArguments.first == "time" )
+    {
+        commandArguments = firstWord( commandArguments.second );
+        int games = commandArguments.first.empty() ? 4 : atoi( commandArguments.first.c_str() );
+
+        commandArguments = firstWord( commandArguments.second );
+        int time = commandArguments.first.empty() ? 10000 : atoi( commandArguments.first.c_str() );
+
+        commandArguments = firstWord( commandArguments.second );
+        int increment = commandArguments.first.empty() ? 100 : atoi( commandArguments.first.c_str() );
+
+        if ( games < 1 || time < 1 || increment < 0 )
+        {
+            ERROR_S( engine, "Illegal bench arguments: %s", arguments.c_str() );
+            return;
+        }
+
+        // The games search with the first thread's data, so nothing else can be searching
+        engine.stopImpl();
+
+        Bench::selfPlayTiming( engine, games, time, increment );
+    }
+    else if ( commandArguments.first == "smp" )
+    {
+        commandArguments = firstWord( commandArguments.second );
+        std::string filename = commandArguments.first;
+
+        commandArguments = firstWord( commandArguments.second );
+        int depth = commandArguments.first.empty() ? 0 : atoi( commandArguments.first.c_str() );
+
+        if ( filename.empty() || depth < 0 )
+        {
+            ERROR_S( engine, "Illegal bench arguments: %s", arguments.c_str() );
+            return;
+        }
+
+        Bench::threadScaling( engine, filename, depth );
+    }
+    else if ( commandArguments.first == "go" )
+    {
+        commandArguments = firstWord( commandArguments.second );
+        int count = commandArguments.first.empty() ? 10000 : atoi( commandArguments.first.c_str() );
+
+        if ( count < 1 )
+        {
+            ERROR_S( engine, "Illegal bench arguments: %s", arguments.c_str() );
+            return;
+        }
+
+        // As a go command would, so that the pool's first thread is idle for the searches
+        engine.stopImpl();
+
+        Bench::goLatency( engine, count );
+    }
+    else if ( commandArguments.first == "depth" )
+    {
+        commandArguments = firstWord( commandArguments.second );
+        int depth = commandArguments.first.empty() ? 7 : atoi( commandArguments.first.c_str() );
+
+        if ( depth < 1 || depth >= static_cast<int>( PrincipalVariation::MAX_PLY ) )
+        {
+            ERROR_S( engine, "Illegal bench arguments: %s", arguments.c_str() );
+            return;
+        }
+
+        Bench::fixedDepth( engine, depth );
+    }
+    else if ( commandArguments.first == "attacks" )
+    {
+        commandArguments = firstWord( commandArguments.second );
+        int iterations = commandArguments.first.empty() ? 100000 : atoi( commandArguments.first.c_str() );
+
+        if ( iterations < 1 )
+        {
+            ERROR_S( engine, "Illegal bench arguments: %s", arguments.c_str() );
+            return;
+        }
+
+        Bench::attackMaps( engine, iterations );
+    }
+    else if ( commandArguments.first == "nnue" )
+    {
+        commandArguments = firstWord( commandArguments.second );
+        int depth = commandArguments.first.empty() ? 7 : atoi( commandArguments.first.c_str() );
+
+        if ( depth < 1 || depth >= static_cast<int>( PrincipalVariation::MAX_PLY ) )
+        {
+            ERROR_S( engine, "Illegal bench arguments: %s", arguments.c_str() );
+            return;
+        }
+
+        if ( !Nnue::isLoaded() )
+        {
+            ERROR_S( engine, "No network loaded - set EvalFile first" );
+            return;
+        }
+
+        Bench::networkEvaluation( engine, depth );
+    }
+    else if ( commandArguments.first.empty() )
+    {
+        ERROR_S( engine, "Missing bench arguments" );
+    }
+    else
+    {
+        ERROR_S( engine, "Unrecognised bench type: %s", commandArguments.first.c_str() );
+    }
+}
+
+void Engine::stoplatencyCommand( Engine& engine, const std::string& arguments )
+{
+    INFO_S( engine, "Processing stoplatency command" );
+
+    // Positions are reached by playing up to this many random plies from the start, and each is searched
+    // for a random time before being stopped
+    static const unsigned int MAX_RANDOM_PLIES = 40;
+    static const unsigned int MIN_SEARCH_MS = 5;
+    static const unsigned int MAX_SEARCH_MS = 50;
+
+    std::pair<std::string, std::string> commandArguments = firstWord( arguments );
+    int count = commandArguments.first.empty() ? 100 : atoi( commandArguments.first.c_str() );
+
+    if ( count < 1 )
+    {
+        ERROR_S( engine, "Illegal stoplatency arguments: %s", arguments.c_str() );
+        return;
+    }
+
+    // Measure from a clean start
+    engine.stopImpl();
+
+    unsigned long long state = 0x9e3779b97f4a7c15ull;
+    auto random = [&state] ()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        return state;
+    };
+
+    // No limits, so it's an infinite search that only a stop will end
+    const GoArguments goArgs = GoArguments::Builder().build();
+
+    std::chrono::steady_clock::time_point bestMoveTime;
+    auto bestMoveHandler = [&bestMoveTime] ( const Move&, const Move& )
+    {
+        bestMoveTime = std::chrono::steady_clock::now();
+    };
+
+    std::vector<long long> latencies;
+    while ( latencies.size() < static_cast<size_t>( count ) )
+    {
+        Board* board = Board::createBoard( Fen::startingPosition );
+
+        MoveList moves;
+        board->getMoves( moves );
+
+        const unsigned long long plies = random() % ( MAX_RANDOM_PLIES + 1 );
+        for ( unsigned long long ply = 0; ply < plies && !moves.empty(); ply++ )
+        {
+            board->applyMove( moves[ random() % moves.size() ] );
+
+            moves.clear();
+            board->getMoves( moves );
+        }
+
+        // A forced move is played without searching, so there'd be nothing to stop
+        if ( moves.size() > 1 )
+        {
+            engine.currentSearch = new Search( *board, goArgs, engine.threads );
+            engine.currentSearch->run( &engine, bestMoveHandler );
+
+            std::this_thread::sleep_for( std::chrono::milliseconds( MIN_SEARCH_MS + random() % ( MAX_SEARCH_MS - MIN_SEARCH_MS + 1 ) ) );
+
+            const std::chrono::steady_clock::time_point stopTime = std::chrono::steady_clock::now();
+            engine.stopImpl();
+
+            // Skip any search that ran out of depth before being stopped
+            if ( bestMoveTime >= stopTime )
+            {
+                latencies.push_back( std::chrono::duration_cast<std::chrono::nanoseconds>( bestMoveTime - stopTime ).count() );
+            }
+        }
+
+        delete board;
+    }
+
+    std::sort( latencies.begin(), latencies.end() );
+
+    engine.infoBroadcast( "string", "stoplatency searches %zu p50 %.1f us p99 %.1f us max %.1f us",
+                          latencies.size(),
+                          latencies[ latencies.size() / 2 ] / 1000.0,
+                          latencies[ latencies.size() * 99 / 100 ] / 1000.0,
+                          latencies.back() / 1000.0 );
+}
+
 // Broadcast commands
 
 void Engine::idBroadcast( const std::string& name, const std::string& author ) const
@@ -725,6 +1095,7 @@ void Engine::infoBroadcast( const std::string& type, const char* format, va_list
     fprintf( broadcastStream, "info %s ", type.c_str() );
     vfprintf( broadcastStream, format, arg );
     fprintf( broadcastStream, "\n" );
+    fflush( broadcastStream );
 }
 
 void Engine::infoBroadcast( const std::string& type, const char* format, ... ) const
@@ -740,10 +1111,39 @@ void Engine::infoBroadcast( const std::string& type, const char* format, ... ) c
     fprintf( broadcastStream, "info %s ", type.c_str() );
     vfprintf( broadcastStream, format, arg );
     fprintf( broadcastStream, "\n" );
+    fflush( broadcastStream );
 
     va_end( arg );
 }
 
+void Engine::infoPvBroadcast( unsigned int depth, unsigned int selDepth, short score, size_t nodes, long long time, const PrincipalVariation& principalVariation ) const
+{
+    DEBUG( "Broadcasting info pv message" );
+
+    const unsigned long long nps = time > 0 ? static_cast<unsigned long long>( nodes ) * 1000 / time : 0;
+
+    // Mate scores are MATE_SCORE less the number of plies to the mate, which UCI wants as a number of moves
+    if ( score >= MATE_THRESHOLD || score <= -MATE_THRESHOLD )
+    {
+        short plies = MATE_SCORE - ( score < 0 ? -score : score );
+
+        // A node with no moves to search keeps its initial score without any adjustment for distance, but then the
+        // line ends with the mate
+        if ( plies < 1 )
+        {
+            plies = static_cast<short>( principalVariation.size() );
+        }
+
+        const short moves = score < 0 ? -( plies / 2 ) : ( plies + 1 ) / 2;
+
+        broadcast( "info depth %u seldepth %u score mate %d nodes %zu nps %llu time %lld pv %s", depth, selDepth, moves, nodes, nps, time, principalVariation.toString().c_str() );
+    }
+    else
+    {
+        broadcast( "info depth %u seldepth %u score cp %d nodes %zu nps %llu time %lld pv %s", depth, selDepth, score, nodes, nps, time, principalVariation.toString().c_str() );
+    }
+}
+
 void Engine::optionBroadcast( const std::string& id, bool value ) const
 {
     INFO( "Broadcasting option message for %s", id.c_str() );
@@ -751,9 +1151,23 @@ void Engine::optionBroadcast( const std::string& id, bool value ) const
     broadcast( "option name %s type check default %s", id.c_str(), value ? "true" : "false" );
 }
 
+void Engine::optionBroadcast( const std::string& id, int value, int min, int max ) const
+{
+    INFO( "Broadcasting option message for %s", id.c_str() );
+
+    broadcast( "option name %s type spin default %d min %d max %d", id.c_str(), value, min, max );
+}
+
+void Engine::optionBroadcast( const std::string& id, const std::string& value ) const
+{
+    INFO( "Broadcasting option message for %s", id.c_str() );
+
+    broadcast( "option name %s type string default %s", id.c_str(), value.c_str() );
+}
+
 // Perft functions
 
-void Engine::perftDepth( const std::string& depthString, const std::string& fenString, bool divide ) const
+void Engine::perftDepth( const std::string& depthString, const std::string& fenString, bool divide, Perft::Generator generator ) const
 {
     DEBUG( "Run perft with depth: %s and FEN string: %s", depthString.c_str(), fenString.c_str() );
 
@@ -764,18 +1178,18 @@ void Engine::perftDepth( const std::string& depthString, const std::string& fenS
     }
     else
     {
-        Perft::perftDepth( depth, fenString, divide );
+        Perft::perftDepth( depth, fenString, divide, generator );
     }
 }
 
-void Engine::perftFen( const std::string& fenString, bool divide ) const
+void Engine::perftFen( const std::string& fenString, bool divide, Perft::Generator generator ) const
 {
     DEBUG( "Run perft with FEN: %s", fenString.c_str() );
     
-    Perft::perftFen( fenString, divide );
+    Perft::perftFen( fenString, divide, generator );
 }
 
-void Engine::perftFile( const std::string& filename, bool divide ) const
+void Engine::perftFile( const std::string& filename, bool divide, Perft::Generator generator ) const
 {
     DEBUG( "Run perft with file: %s", filename.c_str() );
 
@@ -796,7 +1210,7 @@ void Engine::perftFile( const std::string& filename, bool divide ) const
             continue;
         }
 
-        perftFen( line, divide );
+        perftFen( line, divide, generator );
     }
 }
 
@@ -804,13 +1218,11 @@ void Engine::perftFile( const std::string& filename, bool divide ) const
 
 void Engine::stopImpl()
 {
-    if ( stopThinking == false )
+    if ( !stopThinking.exchange( true, std::memory_order_relaxed ) )
     {
-        stopThinking = true;
-
         waitImpl();
 
-        stopThinking = false;
+        stopThinking.store( false, std::memory_order_relaxed );
     }
 }
 
@@ -826,6 +1238,16 @@ void Engine::waitImpl()
     }
 }
 
+void Engine::prepareThreads( unsigned int count ) const
+{
+    threadPool.ensure( count );
+
+    while ( threadData.size() < count )
+    {
+        threadData.push_back( std::make_unique<ThreadData>() );
+    }
+}
+
 void Engine::resetGame( Engine& engine )
 {
     // It is possible we will not get a ucinewgame, so encode the same game reset logic in 'position'
@@ -909,16 +1331,34 @@ void Engine::broadcast( const char* format, ... ) const
 
 // Search 
 
-Engine::Search::Search( Board& board, const GoArguments& goArgs ) :
+void Engine::orderTableMove( MoveList& moves, const Move& tableMove )
+{
+    if ( !tableMove.isNullMove() )
+    {
+        // Move it up rather than swap so the rest of the moves keep their order.
+        // The table only stores enough of the move to identify it, so compare on that basis
+        MoveList::iterator it = std::find_if( moves.begin(), moves.end(), [&] ( const Move& move )
+        {
+            return move.isEquivalent( tableMove );
+        } );
+        if ( it != moves.end() )
+        {
+            moves.moveToFront( it - moves.begin() );
+        }
+    }
+}
+
+Engine::Search::Search( Board& board, const GoArguments& goArgs, unsigned int threads ) :
     board( std::make_shared<Board>( board ) ),
     goArgs( std::make_shared<GoArguments>( goArgs ) ),
-    workerThread( nullptr )
+    threads( threads < 1 ? 1 : threads ),
+    runningEngine( nullptr )
 {
 }
 
 void Engine::Search::run( const Engine* engine )
 {
-    workerThread = new std::thread( &Engine::Search::start, engine, this, &stats, [engine] ( const Move& bestMove, const Move& ponderMove )
+    run( engine, [engine] ( const Move& bestMove, const Move& ponderMove )
     {
         if ( ponderMove.isNullMove() )
         {
@@ -931,146 +1371,227 @@ void Engine::Search::run( const Engine* engine )
     } );
 }
 
+void Engine::Search::run( const Engine* engine, const std::function<void( const Move&, const Move& )>& bestMoveHandler )
+{
+    engine->prepareThreads( threads );
+
+    runningEngine = engine;
+    engine->threadPool.dispatch( 0, [engine, this, bestMoveHandler] ()
+    {
+        start( engine, this, &stats, bestMoveHandler );
+    } );
+}
+
 void Engine::Search::start( const Engine* engine, const Search* search, Stats* stats, const std::function<void( const Move&, const Move& )>& bestMoveHandler )
 {
     // detach a thread to perform the search and - somehow - track for shutdown queues from Engine
     DEBUG_P( engine, "Starting a search" );
 
-    // TODO delete this when we're happy
     auto startSearch = std::chrono::steady_clock::now();
+    const unsigned long long startAllocations = Allocations::getCount();
 
-    unsigned int depth = search->goArgs->getDepth();
+    // Deepen until we reach any depth we were given, run out of time or are told to stop
+    unsigned int maxDepth = search->goArgs->getDepth();
+    if ( maxDepth == 0 )
+    {
+        maxDepth = PrincipalVariation::MAX_PLY - 1;
+    }
+    else if ( maxDepth > PrincipalVariation::MAX_PLY - 1 )
+    {
+        maxDepth = PrincipalVariation::MAX_PLY - 1;
+    }
 
     short bestScore = std::numeric_limits<short>::lowest();
 
     Move bestMove = Move::nullMove;
     Move ponderMove = Move::nullMove;
 
-    // From whose perspective shall we consider this?
-    bool asWhite = search->board->whiteToPlay();
-
-    // Keep going until we are told to quit, or to stop thinking once we have a candidate move
-    bool readyToMove = false;
-    while ( !engine->quitting && (!engine->stopThinking || !readyToMove) )
+    // The clock starts now
+    TimeManager timeManager( *search->goArgs, search->board->whiteToPlay() );
+    timeManager.setStopSignal( &engine->stopThinking );
+    if ( timeManager.isTimed() )
     {
-        // TODO remove this when we're ready
-        DEBUG_P( engine, "Current position scores: %d", search->board->scorePosition( search->board->whiteToPlay() ) );
+        DEBUG_P( engine, "Time limits: soft %lld ms, hard %lld ms", timeManager.getSoftLimit(), timeManager.getHardLimit() );
+    }
+
+    // Normally a no-op, as run() has done this already, but start() may have been called directly
+    engine->prepareThreads( search->threads );
+
+    // The main search uses the working state of thread zero, whichever thread it is actually running on
+    PrincipalVariation* principalVariation = engine->threadData[ 0 ]->principalVariation.get();
+    MoveOrdering* moveOrdering = engine->threadData[ 0 ]->moveOrdering.get();
+
+    // Pawn structure is cached by each thread for itself, and the tables are kept from search to search
+    PawnHashTable* pawnHashTable = engine->threadData[ 0 ]->pawnHashTable.get();
+    pawnHashTable->resetCounts();
+    search->board->setPawnHashTable( pawnHashTable );
+
+    // So are the network's accumulators, if it is being used
+    const bool networkEvaluation = engine->isNetworkEvaluation();
+    std::vector<Nnue::Accumulator>& accumulators = engine->threadData[ 0 ]->accumulators;
+    search->board->setAccumulators( networkEvaluation ? accumulators.data() : nullptr, accumulators.data() + accumulators.size() );
 
-        // Get candidate moves
-        std::vector<Move> moves;
-        moves.reserve( 256 );
-         
-        search->board->getMoves( moves );
-        search->board->sortMoves( moves );
+    // Age the entries left over from previous searches
+    engine->transpositionTable.newSearch();
 
-        stats->nodesTotal += moves.size();
+    // TODO remove this when we're ready
+    DEBUG_P( engine, "Current position scores: %d", search->board->scorePosition( search->board->whiteToPlay() ) );
 
-        // Filter on searchMoves, if there are any
-        if ( !search->goArgs->getSearchMoves().empty() )
+    // Get candidate moves
+    MoveList moves;
+
+    search->board->getMoves( moves );
+    search->board->sortMoves( moves );
+
+    stats->addNodes( moves.size() );
+
+    // Filter on searchMoves, if there are any
+    if ( !search->goArgs->getSearchMoves().empty() )
+    {
+        for ( MoveList::iterator moveIt = moves.begin(); moveIt != moves.end(); )
         {
-            for ( std::vector<Move>::iterator moveIt = moves.begin(); moveIt != moves.end(); )
+            bool found = false;
+            for ( std::vector<Move>::const_iterator searchIt = search->goArgs->getSearchMoves().cbegin(); searchIt != search->goArgs->getSearchMoves().cend(); searchIt++ )
             {
-                bool found = false;
-                for ( std::vector<Move>::const_iterator searchIt = search->goArgs->getSearchMoves().cbegin(); searchIt != search->goArgs->getSearchMoves().cend(); searchIt++ )
+                if ( ( *moveIt ).isEquivalent( *searchIt ) )
                 {
-                    if ( ( *moveIt ).isEquivalent( *searchIt ) )
-                    {
-                        found = true;
-                        break;
-                    }
+                    found = true;
+                    break;
                 }
+            }
 
-                if ( !found )
-                {
-                    moveIt = moves.erase( moveIt );
-                }
-                else
-                {
-                    moveIt++;
-                }
+            if ( !found )
+            {
+                moveIt = moves.erase( moveIt );
             }
-        
-            if ( moves.empty() )
+            else
             {
-                ERROR_P( engine, "No matching searchmoves" );
-
-                // Stopping seems the appropriate action here
-                readyToMove = true;
-                break;
+                moveIt++;
             }
         }
 
         if ( moves.empty() )
         {
-            ERROR_P( engine, "No moves available" );
-
-            // Stopping seems the appropriate action here, too
-            readyToMove = true;
-            break;
+            ERROR_P( engine, "No matching searchmoves" );
         }
+    }
+    else if ( moves.empty() )
+    {
+        ERROR_P( engine, "No moves available" );
+    }
 
+    if ( moves.size() == 1 && search->goArgs->getSearchMoves().empty() )
+    {
         // Don't waste clock time on a forced move - unless it was a searchmove, where it is likely
         // the user is just trying to analyse that single move at some depth
-        if ( moves.size() == 1 && search->goArgs->getSearchMoves().empty() )
+        DEBUG_P( engine, "Only one move available" );
+
+        bestMove = moves[ 0 ];
+    }
+    else if ( !moves.empty() )
+    {
+        // Have a move ready in case we are stopped before the first iteration completes
+        bestMove = moves[ 0 ];
+
+        // Try the best move from any previous search of this position first
+        Move tableMove = Move::nullMove;
+        short tableScore;
+        unsigned short tableDepth;
+        TranspositionTable::Bound tableBound;
+        if ( engine->transpositionTable.probe( search->board->getHashKey(), tableMove, tableScore, tableDepth, tableBound ) )
         {
-            DEBUG_P( engine, "Only one move available" );
+            stats->tableHits++;
 
-            bestMove = moves[ 0 ];
-            readyToMove = true;
-            break;
+            orderTableMove( moves, tableMove );
         }
 
-        // TODO sort moves
+        // Lazy SMP - helper threads run the same search on their own copy of the board, sharing only the transposition
+        // table. They carry on until the main thread here is done, and then are told to stop
+        std::atomic<bool> helpersStopping( false );
+        std::vector<const Stats*> helperStats;
 
-        Board::State undo( search->board.get() );
-        for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+        // Set up every helper before any of them starts, as the main thread will be making moves on the board
+        for ( unsigned int thread = 1; thread < search->threads; thread++ )
         {
-            // TODO delete this when we're happy
-#ifdef SHOW_LINES
-            DEBUG_P( engine, "Considering %s", ( *it ).toString().c_str() );
-#endif
-            auto startTime = std::chrono::steady_clock::now();
-
-            search->board->applyMove( *it );
-            short score = engine->minmax( *(search->board.get()),
-                                          stats,
-                                          depth,
-                                          false,
-                                          std::numeric_limits<short>::lowest(),
-                                          std::numeric_limits<short>::max(),
-                                          false,
-                                          asWhite,
-                                          ( *it ).toString() );
-            search->board->unmakeMove( undo );
-
-            if ( score > bestScore )
-            {
-                bestScore = score;
-                bestMove = *it;
+            ThreadData& data = *engine->threadData[ thread ];
 
-                // We at least have a move to make if we get stopped
-                readyToMove = true;
+            data.stats.reset();
+            if ( data.board )
+            {
+                *data.board = *search->board;
+            }
+            else
+            {
+                data.board = std::make_unique<Board>( *search->board );
             }
+            data.board->setPawnHashTable( data.pawnHashTable.get() );
+            data.pawnHashTable->resetCounts();
+            data.board->setAccumulators( networkEvaluation ? data.accumulators.data() : nullptr, data.accumulators.data() + data.accumulators.size() );
+            data.moves = moves;
 
-            // TODO delete this when we're happy
-            auto endTime = std::chrono::steady_clock::now();
-            std::chrono::duration<double> diff = endTime - startTime;
-#ifdef SHOW_LINES
-            DEBUG_P( engine, "  score for %s is %d (%.6f s) (%d ms)", ( *it ).toString().c_str(), score, diff, std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() );
-#endif
+            helperStats.push_back( &data.stats );
+        }
+        for ( unsigned int thread = 1; thread < search->threads; thread++ )
+        {
+            // Copied here, before the main search starts changing its own as it checks the time
+            TimeManager helperTimeManager( timeManager );
+            helperTimeManager.setStopSignal( &helpersStopping );
+
+            engine->threadPool.dispatch( thread, [engine, maxDepth, thread, helperTimeManager] () mutable
+            {
+                ThreadData& data = *engine->threadData[ thread ];
+
+                Move helperMove = data.moves[ 0 ];
+                short helperScore = std::numeric_limits<short>::lowest();
+                iterate( engine, *data.board, data.moves, &data.stats, &helperTimeManager, data.principalVariation.get(), data.moveOrdering.get(), maxDepth, thread, nullptr, helperMove, helperScore );
+            } );
         }
 
-        // TODO this probably isn't how we want to do it - especially if we're not doing a depth search
-        // one to consider with iterative deepening and quiescent searches
-        if ( readyToMove )
+        iterate( engine, *search->board, moves, stats, &timeManager, principalVariation, moveOrdering, maxDepth, 0, &helperStats, bestMove, bestScore );
+
+        helpersStopping = true;
+        for ( unsigned int thread = 1; thread < search->threads; thread++ )
         {
-            break;
+            engine->threadPool.wait( thread );
+        }
+
+        // Include the helpers in the totals reported below
+        for ( std::vector<const Stats*>::const_iterator it = helperStats.cbegin(); it != helperStats.cend(); it++ )
+        {
+            stats->addNodes( ( *it )->nodesTotal );
+            stats->nodesExcluded += ( *it )->nodesExcluded;
+            stats->tableHits += ( *it )->tableHits;
+        }
+        for ( unsigned int thread = 1; thread < search->threads; thread++ )
+        {
+            stats->pawnHashProbes += engine->threadData[ thread ]->pawnHashTable->getProbes();
+            stats->pawnHashHits += engine->threadData[ thread ]->pawnHashTable->getHits();
+        }
+
+        // The reply we expect is the one to ponder on
+        if ( principalVariation->size() > 1 && ( *principalVariation )[ 0 ] == bestMove )
+        {
+            ponderMove = ( *principalVariation )[ 1 ];
         }
     }
 
-    if ( !engine->quitting ) 
+    stats->pawnHashProbes += pawnHashTable->getProbes();
+    stats->pawnHashHits += pawnHashTable->getHits();
+
+    if ( !engine->quitting.load( std::memory_order_relaxed ) )
     {
         DEBUG_P( engine, "Best move: %s. Score %d", bestMove.toString().c_str(), bestScore);
+
+        if ( engine->uciDebug )
+        {
+            engine->infoBroadcast( "string", "hash tornreads %llu", engine->transpositionTable.getTornReads() );
+            engine->infoBroadcast( "string", "pawnhash probes %zu hits %zu", stats->pawnHashProbes, stats->pawnHashHits );
+
+            if ( Allocations::isCounting() )
+            {
+                engine->infoBroadcast( "string", "allocations %llu nodes %zu", Allocations::getCount() - startAllocations, stats->nodesTotal.load() );
+            }
+        }
         
         bestMoveHandler( bestMove, ponderMove );
     }
@@ -1078,415 +1599,516 @@ void Engine::Search::start( const Engine* engine, const Search* search, Stats* s
     // TODO delete this when we're happy
     auto endSearch = std::chrono::steady_clock::now();
     std::chrono::duration<double> diff = endSearch - startSearch;
-    DEBUG_P( engine, "Search completed (%.6f s) (%d ms) (%d/%d nodes)", diff, std::chrono::duration_cast<std::chrono::milliseconds>( diff ).count(), stats->nodesTotal-stats->nodesExcluded, stats->nodesTotal );
+    DEBUG_P( engine, "Search completed (%.6f s) (%d ms) (%zu/%zu nodes) (%zu table hits)", diff, std::chrono::duration_cast<std::chrono::milliseconds>( diff ).count(), stats->nodesTotal - stats->nodesExcluded, stats->nodesTotal.load(), stats->tableHits );
 }
 
-short Engine::quiesce( Board& board, short depth, short alphaInput, short betaInput, bool maximising, bool asWhite, std::string line ) const
+void Engine::Search::iterate( const Engine* engine, Board& board, MoveList& moves, Stats* stats, TimeManager* timeManager, PrincipalVariation* principalVariation, MoveOrdering* moveOrdering, unsigned int maxDepth, unsigned int thread, const std::vector<const Stats*>* helperStats, Move& bestMove, short& bestScore )
 {
-    DEBUG( "Quiescence search of %s", line.c_str() );
+    // Helpers skip some depths, each to its own pattern, so that the threads spread themselves over several depths
+    // rather than all searching the same tree in step
+    static const unsigned int SKIP_PATTERNS = 20;
+    static const unsigned int SKIP_SIZE[ SKIP_PATTERNS ] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+    static const unsigned int SKIP_PHASE[ SKIP_PATTERNS ] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
 
-    // Make some working values so we are not "editing" method parameters
-    short alpha = alphaInput;
-    short beta = betaInput;
+    // From this depth on, each iteration starts with a narrow window around the score from the one before, which is
+    // widened on whichever side the score falls outside it
+    static const unsigned int ASPIRATION_DEPTH = 4;
+    static const int ASPIRATION_WINDOW = 50;
 
-    // If is win, return max
-    // If is loss, return lowest
-    // If draw, return 0
-    // otherwise iterate
+    const bool mainThread = thread == 0;
 
-    // Simple win semantics
-    short score = 0;
-    if ( board.isTerminal( score ) )
+    const unsigned long long hashKey = board.getHashKey();
+
+    moveOrdering->newSearch();
+
+    Board::State undo( board );
+    for ( unsigned int depth = 1; depth <= maxDepth && timeManager->canStartIteration(); depth++ )
     {
-        // Why? Win (+1), Loss (-1) or Stalemate (0)
-        if ( score == 0 )
+        if ( !mainThread )
         {
-            //DEBUG( "Score 0 (stalemate) as %s with %s to play", asWhite ? "white" : "black", board.whiteToPlay() ? "white" : "black" );
-#ifdef SHOW_LINES
-            DEBUG( "Q3: %s scores %d", line.c_str(), score );
-#endif
-            return 0;
-        }
-        else
-        {
-            DEBUG( "Q isTerminal returns %d for %s", score, line.c_str() );
-            if ( board.whiteToPlay() != asWhite )
+            const unsigned int pattern = ( thread - 1 ) % SKIP_PATTERNS;
+            if ( ( ( depth + SKIP_PHASE[ pattern ] ) / SKIP_SIZE[ pattern ] ) % 2 != 0 )
             {
-                score = -score;
-                DEBUG( "Q  result corrected to %d to be relative to current player", score );
+                continue;
             }
+        }
 
-#ifdef SHOW_LINES
-            DEBUG( "Q6: Score %d (terminal) as %s with %s to play from %s", score, asWhite ? "white" : "black", board.whiteToPlay() ? "white" : "black", line.c_str() );
-#endif
+        int delta = ASPIRATION_WINDOW;
+        short alpha = -INFINITE_SCORE;
+        short beta = INFINITE_SCORE;
+        if ( depth >= ASPIRATION_DEPTH && bestScore > -MATE_THRESHOLD && bestScore < MATE_THRESHOLD )
+        {
+            alpha = static_cast<short>( std::max<int>( bestScore - delta, -INFINITE_SCORE ) );
+            beta = static_cast<short>( std::min<int>( bestScore + delta, INFINITE_SCORE ) );
+        }
 
-            // Give it a critially large value, but not quite at lowest/highest...
-            // so we have some wiggle room so we can make one winning line seem preferable to another
-            score = score < 0 ? std::numeric_limits<short>::lowest() + 1000 : std::numeric_limits<short>::max() - 1000;
+        short iterationScore;
+        Move iterationMove;
 
-            // Adjusting the return with the depth means that it'll chase shorter lines to terminal positions rather
-            // than just settling for a forced mate being something it can commit to at any time
-            if ( score < 0 )
-            {
-                score -= depth;
-            }
-            else
-            {
-                score += depth;
-            }
+        while ( true )
+        {
+            iterationScore = -INFINITE_SCORE;
+            iterationMove = Move::nullMove;
 
-#ifdef SHOW_LINES
-            DEBUG( "Q2: %s scores %d", line.c_str(), score );
-#endif
-            return score;
-        }
-    }
+            principalVariation->clear( 0 );
 
-    if ( depth == 0 || stopThinking )
-    {
-        score = board.scorePosition( asWhite );
-        //DEBUG( "Score %d (depth 0 or stopThinking) as %s with %s to play", score, asWhite ? "white" : "black", board.whiteToPlay() ? "white" : "black" );
+            // Principal variation search, as in negamax, with the window raised as better moves are found
+            short rootAlpha = alpha;
+            for ( MoveList::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+            {
 #ifdef SHOW_LINES
-        DEBUG( "Q1: %s scores %d", line.c_str(), score );
+                DEBUG_P( engine, "Considering %s at depth %d", ( *it ).toString().c_str(), depth );
 #endif
+                principalVariation->setPathMove( 0, *it );
+                principalVariation->clear( 1 );
 
-        return score;
-    }
-
-    if ( maximising )
-    {
-        score = std::numeric_limits<short>::lowest();
+                board.applyMove( *it );
+                short score;
+                if ( it == moves.cbegin() )
+                {
+                    score = -engine->negamax( board, stats, timeManager, depth - 1, 1, 0, false, -beta, -rootAlpha, principalVariation, moveOrdering );
+                }
+                else
+                {
+                    score = -engine->negamax( board, stats, timeManager, depth - 1, 1, 0, false, -rootAlpha - 1, -rootAlpha, principalVariation, moveOrdering );
+                    if ( score > rootAlpha && score < beta && !timeManager->hasExpired() )
+                    {
+                        principalVariation->clear( 1 );
+                        score = -engine->negamax( board, stats, timeManager, depth - 1, 1, 0, false, -beta, -rootAlpha, principalVariation, moveOrdering );
+                    }
+                }
+                board.unmakeMove( undo );
 
-        std::vector<Move> moves;
-        moves.reserve( 256 );
-        board.getMoves( moves );
-        board.sortMoves( moves );
+                // A move whose search was interrupted has an unreliable score, so ignore it
+                if ( timeManager->hasExpired() )
+                {
+                    break;
+                }
 
-        for ( std::vector<Move>::iterator it = moves.begin(); it != moves.end(); )
-        {
-            if ( ( *it ).isQuiet() )
-            {
-                it = moves.erase( it );
+                if ( score > iterationScore )
+                {
+                    iterationScore = score;
+                }
+                if ( score > rootAlpha )
+                {
+                    rootAlpha = score;
+                    iterationMove = *it;
+                    principalVariation->update( 0, *it );
+                }
+                if ( score >= beta )
+                {
+                    break;
+                }
             }
-            else
+
+            if ( timeManager->hasExpired() )
             {
-                it++;
+                break;
             }
-        }
-        if ( moves.empty() )
-        {
-            DEBUG( "Q8: %s scores %d", line.c_str(), board.scorePosition( asWhite ) );
-            return board.scorePosition( asWhite );
-        }
-
-        int count = 1;
-        Board::State undo = Board::State( board );
-        for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++, count++ )
-        {
-            INFO( "Q Considering %s at depth %d (maximising)", (line+" "+( *it ).toString().c_str()).c_str(), depth);
 
-            board.applyMove( *it );
-
-            // Go into a quiescent search if it looks sensible to do so
-            short evaluation = quiesce( board, depth - 1, alpha, beta, !maximising, asWhite, line + " " + ( *it ).toString() );// TODO quiesce
-
-            board.unmakeMove( undo );
-
-            if ( evaluation > score )
+            // Outside the window, the score is only a bound - so widen the window on that side and search again. After a
+            // fail high, start with the move that did it
+            if ( iterationScore <= alpha && alpha > -INFINITE_SCORE )
             {
-                score = evaluation;
+                alpha = static_cast<short>( std::max<int>( alpha - delta, -INFINITE_SCORE ) );
             }
-            if ( score > alpha )
+            else if ( iterationScore >= beta && beta < INFINITE_SCORE )
             {
-                alpha = score;
+                beta = static_cast<short>( std::min<int>( beta + delta, INFINITE_SCORE ) );
+                moves.moveToFront( std::find( moves.begin(), moves.end(), iterationMove ) - moves.begin() );
             }
-            if ( score >= beta )
+            else
             {
-                DEBUG( "Q Exiting maximising after %d/%d moves considered", count, moves.size() );
                 break;
             }
-        }
 
-#ifdef SHOW_LINES
-        DEBUG( "Q4: %s scores %d", line.c_str(), score );
-#endif
-        return score;
-    }
-    else
-    {
-        score = std::numeric_limits<short>::max();
-
-        std::vector<Move> moves;
-        moves.reserve( 256 );
-        board.getMoves( moves );
-        board.sortMoves( moves );
+            delta *= 2;
+        }
 
-        for ( std::vector<Move>::iterator it = moves.begin(); it != moves.end(); )
+        // The previous best move is searched first, so even a partial iteration is at least as good a guide -
+        // provided it got as far as finishing that move
+        const bool bestMoveChanged = depth > 1 && !iterationMove.isNullMove() && iterationMove != bestMove;
+        if ( !iterationMove.isNullMove() )
         {
-            if ( ( *it ).isQuiet() )
-            {
-                it = moves.erase( it );
-            }
-            else
-            {
-                it++;
-            }
+            bestScore = iterationScore;
+            bestMove = iterationMove;
         }
-        if ( moves.empty() )
+
+        if ( timeManager->hasExpired() )
         {
-            DEBUG( "Q9: %s scores %d", line.c_str(), board.scorePosition( asWhite ) );
-            return board.scorePosition( asWhite );
+            break;
         }
 
-        int count = 1;
-        Board::State undo = Board::State( board );
-        for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++, count++ )
+        // The last search of this depth fell inside its window, so this is an exact score
+        engine->transpositionTable.store( hashKey, bestMove, scoreToTable( bestScore, 0 ), depth, TranspositionTable::Bound::EXACT );
+
+        if ( mainThread )
         {
-            INFO( "Q Considering %s at depth %d (minimising)", (line+" "+( *it ).toString().c_str()).c_str(), depth);
+            timeManager->iterationComplete( bestMoveChanged );
+
+            size_t nodes = stats->nodesTotal;
+            if ( helperStats != nullptr )
+            {
+                for ( std::vector<const Stats*>::const_iterator it = helperStats->cbegin(); it != helperStats->cend(); it++ )
+                {
+                    nodes += ( *it )->nodesTotal.load( std::memory_order_relaxed );
+                }
+            }
 
-            board.applyMove( *it );
+            engine->infoPvBroadcast( depth, stats->selDepth, bestScore, nodes, timeManager->elapsed(), *principalVariation );
+        }
 
-            // Go into a quiescent search if it looks sensible to do so
-            short evaluation = quiesce( board, depth - 1, alpha, beta, !maximising, asWhite, line + " " + ( *it ).toString() );// TODO quiesce
+        // Search the best move first next time around
+        moves.moveToFront( std::find( moves.begin(), moves.end(), bestMove ) - moves.begin() );
+    }
+}
 
-            board.unmakeMove( undo );
+short Engine::lateMoveReduction( short depth, int moveNumber )
+{
+    static const size_t TABLE_SIZE = 64;
 
-            if ( evaluation < score )
-            {
-                score = evaluation;
-            }
-            if ( score < beta )
-            {
-                beta = score;
-            }
-            if ( score <= alpha )
+    // Grows with the log of each, worked out once
+    static const std::array<std::array<short, TABLE_SIZE>, TABLE_SIZE> reductions = [] ()
+    {
+        std::array<std::array<short, TABLE_SIZE>, TABLE_SIZE> table = {};
+        for ( size_t tableDepth = 1; tableDepth < TABLE_SIZE; tableDepth++ )
+        {
+            for ( size_t tableMove = 1; tableMove < TABLE_SIZE; tableMove++ )
             {
-                DEBUG( "Q Exiting minimising after %d/%d moves considered", count, moves.size() );
-                break;
+                table[ tableDepth ][ tableMove ] = static_cast<short>( 0.75 + std::log( tableDepth ) * std::log( tableMove ) / 2.25 );
             }
         }
-    }
+        return table;
+    }();
+
+    const short reduction = reductions[ std::min<size_t>( depth, TABLE_SIZE - 1 ) ][ std::min<size_t>( moveNumber, TABLE_SIZE - 1 ) ];
 
-    DEBUG( "QA: %s scores %d", line.c_str(), board.scorePosition( asWhite ) );
-    return board.scorePosition( asWhite );
+    // Always leave at least one ply to search
+    return std::min<short>( reduction, depth - 2 );
 }
 
-short Engine::minmax( Board& board, Stats* stats, short depth, bool quiescent, short alphaInput, short betaInput, bool maximising, bool asWhite, std::string line ) const
+short Engine::negamax( Board& board, Stats* stats, TimeManager* timeManager, short depth, short ply, short extensions, bool quiescent, short alphaInput, short betaInput, PrincipalVariation* pv, MoveOrdering* moveOrdering, const Move& excludedMove ) const
 {
+    // Selective search - how close to the horizon each kind of pruning is tried, and with what margins
+    static const short REVERSE_FUTILITY_DEPTH = 3;
+    static const short REVERSE_FUTILITY_MARGIN = 120;
+    static const short FUTILITY_DEPTH = 2;
+    static const short FUTILITY_MARGIN = 100;
+    static const short NULL_MOVE_DEPTH = 3;
+    static const short LATE_MOVE_DEPTH = 3;
+    static const int LATE_MOVE_COUNT = 3;
+
+    // How deep quiescence goes past the horizon, how many plies a line can be extended by in all, and how deep a search
+    // needs to be, and how far the other moves need to fall short, for the table move to be singular
+    static const short QUIESCENCE_DEPTH = 4;
+    static const short MAX_EXTENSIONS = 8;
+    static const short SINGULAR_DEPTH = 6;
+    static const short SINGULAR_MARGIN = 50;
+
     // Make some working values so we are not "editing" method parameters
     short alpha = alphaInput;
     short beta = betaInput;
 
-    // If is win, return max
-    // If is loss, return lowest
-    // If draw, return 0
-    // otherwise iterate
+    // At the horizon, carry on with captures, promotions and checks - and every evasion when in check - until the
+    // position is quiet
+    if ( depth <= 0 && !quiescent )
+    {
+        quiescent = true;
+        depth = QUIESCENCE_DEPTH;
+    }
+
+    // Only a node searched to a depth, and with no move left out, has a result to share through the transposition table
+    const bool tableNode = !quiescent && depth > 0;
+    const short tableDepth = depth;
+    const unsigned long long hashKey = board.getHashKey();
+    const bool white = board.whiteToPlay();
 
-    // Simple win semantics
-    short score = 0;
-    if ( board.isTerminal( score ) )
+    if ( ply > stats->selDepth )
     {
-        // Why? Win (+1), Loss (-1) or Stalemate (0)
-        if ( score == 0 )
-        {
-#ifdef SHOW_LINES
-            DEBUG( "3: %s scores %d%s", line.c_str(), score, ( quiescent ? " quiescent" : "" ) );
-#endif
-            return 0;
-        }
-        else
-        {
-            if ( board.whiteToPlay() != asWhite )
-            {
-                score = -score;
-            }
+        stats->selDepth = ply;
+    }
 
+    // Before anything expensive, so that a stop is acted on within a node of it arriving
+    if ( timeManager->checkTime() )
+    {
+        const short score = board.scorePosition( white );
 #ifdef SHOW_LINES
-            DEBUG( "6: Score %d (terminal) as %s with %s to play from %s%s", score, asWhite ? "white" : "black", board.whiteToPlay() ? "white" : "black", line.c_str(), ( quiescent ? " quiescent" : "" ) );
+        DEBUG( "1: %s scores %d%s", pv->pathToString( ply ).c_str(), score, ( quiescent ? " quiescent" : "" ) );
 #endif
 
-            // Give it a critially large value, but not quite at lowest/highest...
-            // so we have some wiggle room so we can make one winning line seem preferable to another
-            score = score < 0 ? std::numeric_limits<short>::lowest() + 1000 : std::numeric_limits<short>::max() - 1000;
+        return score;
+    }
 
-            // Adjusting the return with the depth means that it'll chase shorter lines to terminal positions rather
-            // than just settling for a forced mate being something it can commit to at any time
-            if ( score < 0 )
-            {
-                score -= depth;
-            }
-            else
+    // See if we have already searched this position deeply enough to use that result directly
+    Move tableMove = Move::nullMove;
+    short tableScore = 0;
+    unsigned short storedDepth = 0;
+    TranspositionTable::Bound tableBound = TranspositionTable::Bound::UPPER;
+    if ( tableNode )
+    {
+        if ( transpositionTable.probe( hashKey, tableMove, tableScore, storedDepth, tableBound ) )
+        {
+            stats->tableHits++;
+
+            // Stored relative to the side to move, as is the score here
+            tableScore = scoreFromTable( tableScore, ply );
+
+            // With a move left out, the stored result is for different moves to the ones being searched
+            if ( storedDepth >= tableDepth && excludedMove.isNullMove() )
             {
-                score += depth;
-            }
+                const bool lowerBound = tableBound != TranspositionTable::Bound::UPPER;
+                const bool upperBound = tableBound != TranspositionTable::Bound::LOWER;
 
-#ifdef SHOW_LINES
-            DEBUG( "2: %s scores %d%s", line.c_str(), score, ( quiescent ? " quiescent" : "" ) );
-#endif
-            return score;
+                if ( ( lowerBound && tableScore >= beta ) || ( upperBound && tableScore <= alpha ) || ( lowerBound && upperBound ) )
+                {
+                    return tableScore;
+                }
+            }
         }
     }
 
-    if ( stopThinking )
+    // Checkmate and stalemate aren't looked for here - they show up as a node with no moves to search, without a
+    // separate generation to find out
+    short score = 0;
+    if ( depth == 0 || ply >= static_cast<short>( PrincipalVariation::MAX_PLY - 1 ) )
     {
-        score = board.scorePosition( asWhite );
+        // No moves are generated here, so a mate at the end of a line of checks needs looking for on its own
+        score = board.isInCheck() && !board.hasLegalMove() ? -( MATE_SCORE - ply ) : board.scorePosition( white );
 #ifdef SHOW_LINES
-        DEBUG( "1: %s scores %d%s", line.c_str(), score, ( quiescent ? " quiescent" : "" ) );
+        DEBUG( "7: %s scores %d%s", pv->pathToString( ply ).c_str(), score, ( quiescent ? " quiescent" : "" ) );
 #endif
 
         return score;
     }
 
-    if ( depth == 0 )
-    {
-        score = board.scorePosition( asWhite );
-#ifdef SHOW_LINES
-        DEBUG( "7: %s scores %d%s", line.c_str(), score, ( quiescent ? " quiescent" : "" ) );
-#endif
+    const bool inCheck = board.isInCheck();
+    const Move previousMove = ply > 0 ? pv->getPathMove( ply - 1 ) : Move::nullMove;
 
-        return score;
-    }
+    // Selective search is only for nodes that a null window is enough for - not on the principal variation - and not
+    // in quiescence or when in check. Nor when a move is left out, where the question is how the others compare with it
+    const bool pvNode = beta - alpha > 1;
+    const bool selective = tableNode && !pvNode && !inCheck && excludedMove.isNullMove();
 
-    if ( maximising )
+    short staticScore = 0;
+    bool futile = false;
+    if ( selective )
     {
-        score = std::numeric_limits<short>::lowest();
+        staticScore = board.scorePosition( white );
 
-        std::vector<Move> moves;
-        moves.reserve( 256 );
-        
-        board.getMoves( moves );
-        stats->nodesTotal += moves.size();
+        // Reverse futility pruning - close to the horizon and so far above beta that the opponent can't be expected to
+        // get back into it in the depth left
+        if ( futilityPruning && depth <= REVERSE_FUTILITY_DEPTH && beta > -MATE_THRESHOLD && beta < MATE_THRESHOLD && staticScore - REVERSE_FUTILITY_MARGIN * depth >= beta )
+        {
+            return staticScore;
+        }
 
-        int count = 1;
-        Board::State undo = Board::State( board );
-        for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++, count++ )
+        // Null move pruning - if passing still leaves us at or above beta, a real move is almost certain to, so a shallower
+        // search is enough to show it. Not twice in a row, and not with only pawns left, where passing might well be
+        // better than any move there is
+        if ( nullMovePruning && depth >= NULL_MOVE_DEPTH && staticScore >= beta && beta > -MATE_THRESHOLD && beta < MATE_THRESHOLD && !previousMove.isNullMove() && board.hasNonPawnMaterial() )
         {
-#ifdef SHOW_LINES
-            DEBUG( "Considering %s at depth %d%s (maximising)", (line + " " + (*it).toString().c_str()).c_str(), depth, ( quiescent ? " quiescent" : "" ) );
-#endif
-            board.applyMove( *it );
+            // More reduction the deeper the search and the further above beta, going no further than quiescence
+            const short reduction = 2 + depth / 4 + std::min( ( staticScore - beta ) / 200, 2 );
+            const short nullDepth = static_cast<short>( std::max( depth - 1 - reduction, 0 ) );
+
+            pv->setPathMove( ply, Move::nullMove );
+            pv->clear( ply + 1 );
 
-            // Go into a quiescent search if it looks sensible to do so
-            short evaluation;
-#ifdef QUIESCE
-            if ( depth == 1 && !( *it ).isQuiet() )
+            Board::State undo = Board::State( board );
+            board.applyNullMove();
+            const short nullScore = -negamax( board, stats, timeManager, nullDepth, ply + 1, extensions, false, -beta, -beta + 1, pv, moveOrdering );
+            board.unmakeMove( undo );
+
+            if ( nullScore >= beta && !timeManager->hasExpired() )
             {
-                // TODO make depth configurable or calculated
-                evaluation = quiesce( board, 4, alpha, beta, !maximising, asWhite, line + " " + ( *it ).toString() );// TODO quiesce
-                //DEBUG( "***** Back from Q (max) with %d", evaluation );
-            }
-            else
-#endif
-            {
-                if ( quiescent && ( *it ).isQuiet() )
-                {
-                    evaluation = board.scorePosition( asWhite );
-                }
-                else
-                {
-                    if ( depth == 1 && !quiescent && !(*it).isQuiet() )
-                    {
-                        quiescent = true;
-                        depth = 5;
-                    }
-                    evaluation = minmax( board, stats, depth - 1, quiescent, alpha, beta, !maximising, asWhite, line + " " + ( *it ).toString() );
-                }
+                // A mate found after passing isn't to be trusted
+                return nullScore >= MATE_THRESHOLD ? beta : nullScore;
             }
+        }
 
-            board.unmakeMove( undo );
+        // Futility pruning - close to the horizon and so far below alpha that a quiet move, which leaves the material as
+        // it is, can't be expected to bring it back
+        futile = futilityPruning && depth <= FUTILITY_DEPTH && alpha > -MATE_THRESHOLD && alpha < MATE_THRESHOLD && staticScore + FUTILITY_MARGIN * depth <= alpha;
+    }
+
+    // Singular extension - if a shallower search of every other move falls well short of what the table has for the
+    // table move, it is the one move that holds the position, and is searched a ply deeper
+    bool singular = false;
+    if ( tableNode && ply > 0 && depth >= SINGULAR_DEPTH && excludedMove.isNullMove() && extensions < MAX_EXTENSIONS && !tableMove.isNullMove()
+        && tableBound != TranspositionTable::Bound::UPPER && storedDepth + 3 >= depth && tableScore > -MATE_THRESHOLD && tableScore < MATE_THRESHOLD )
+    {
+        const short singularBeta = tableScore - SINGULAR_MARGIN;
+        const short singularScore = negamax( board, stats, timeManager, ( depth - 1 ) / 2, ply, extensions, false, singularBeta - 1, singularBeta, pv, moveOrdering, tableMove );
+        pv->clear( ply );
+
+        singular = singularScore < singularBeta && !timeManager->hasExpired();
+    }
+
+    score = -INFINITE_SCORE;
+
+    MoveList moves;
 
-            if ( evaluation > score )
+    // Only in quiescence, and only when not in check, are captures that lose material passed over
+    bool pruneLosingCaptures = false;
+
+    if ( quiescent )
+    {
+        // A quiet move that isn't a check leaves the material as it is, so rather than generate each one only to score
+        // the position it leads to, take the score of the position as it stands - unless in check, when every evasion
+        // is searched
+        if ( !inCheck )
+        {
+            score = board.scorePosition( white );
+            if ( score >= beta )
             {
-                score = evaluation;
+                return score;
             }
             if ( score > alpha )
             {
                 alpha = score;
             }
-            if ( score >= beta ) // TODO try with if(beta<=alpha) as per https://www.geeksforgeeks.org/minimax-algorithm-in-game-theory-set-4-alpha-beta-pruning/
-            {
-#ifdef SHOW_LINES
-                DEBUG( "Exiting maximising after %d/%d%s moves considered", count, moves.size(), ( quiescent ? " quiescent" : "" ) );
-#endif
-                stats->nodesExcluded += ( moves.size() - count );
-                break;
-            }
-        }
 
-#ifdef SHOW_LINES
-        DEBUG( "4: %s scores %d", line.c_str(), score);
-#endif
-        return score;
+            pruneLosingCaptures = true;
+        }
     }
-    else
+
+    // Try the best move from any previous search of this position first, then the best of the captures, and then the
+    // quiet moves that have caused cut-offs elsewhere - each stage only generated if the one before doesn't cut off
+    MovePicker picker( board, moves, quiescent, excludedMove.isNullMove() ? tableMove : excludedMove, moveOrdering, ply, previousMove );
+    if ( !excludedMove.isNullMove() )
     {
-        score = std::numeric_limits<short>::max();
+        picker.excludeTableMove();
+    }
+
+    Move bestMove = Move::nullMove;
 
-        std::vector<Move> moves;
-        moves.reserve( 256 );
+    int count = 1;
+    Board::State undo = Board::State( board );
+    for ( ; picker.hasNext(); count++ )
+    {
+        const Move& move = picker.next();
 
-        board.getMoves( moves );
-        stats->nodesTotal += moves.size();
+        // Losing captures are picked last, so the rest of the moves are too
+        if ( pruneLosingCaptures && picker.getScore() < 0 )
+        {
+            stats->nodesExcluded += ( moves.size() - count + 1 );
+            break;
+        }
 
-        int count = 1;
-        Board::State undo = Board::State( board );
-        for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++, count++ )
+        // Keep the first move, so that there is a score to return
+        if ( futile && count > 1 && move.isQuiet() )
         {
+            stats->nodesExcluded++;
+            continue;
+        }
+
+        pv->setPathMove( ply, move );
+        pv->clear( ply + 1 );
+
 #ifdef SHOW_LINES
-            DEBUG( "Considering %s at depth %d%s (minimising)", (line + " " + ( *it ).toString().c_str()).c_str(), depth, ( quiescent ? " quiescent" : "" ) );
+        DEBUG( "Considering %s at depth %d%s", pv->pathToString( ply + 1 ).c_str(), depth, ( quiescent ? " quiescent" : "" ) );
 #endif
-            board.applyMove( *it );
+        board.applyMove( move );
+
+        short evaluation;
+        if ( quiescent && move.isQuiet() )
+        {
+            evaluation = board.scorePosition( white );
+        }
+        else
+        {
+            // Extensions - a check, or a singular table move, is searched a ply deeper, up to a limit for the line as a
+            // whole so that a long run of checks can't run away with the search
+            short extension = 0;
+            if ( !quiescent && extensions < MAX_EXTENSIONS && ( move.isCheckingMove() || ( singular && move.isEquivalent( tableMove ) ) ) )
+            {
+                extension = 1;
+            }
+            const short newDepth = depth - 1 + extension;
+            const short newExtensions = extensions + extension;
 
-            // Go into a quiescent search if it looks sensible to do so
-            short evaluation;
-#ifdef QUIESCE
-            if ( depth == 1 && !( *it ).isQuiet() )
+            // Principal variation search - the first move is expected to be the best, so the rest are only searched
+            // with a null window, to show that they are no better. Any that turns out to be better, unless it is
+            // already good enough to cut off, is searched again with the full window for its real score
+            if ( count == 1 )
             {
-                // TODO make depth configurable or calculated
-                evaluation = quiesce( board, 4, alpha, beta, !maximising, asWhite, line + " " + ( *it ).toString() );// TODO quiesce
-                //DEBUG( "***** Back from Q (min) with %d", evaluation );
+                evaluation = -negamax( board, stats, timeManager, newDepth, ply + 1, newExtensions, quiescent, -beta, -alpha, pv, moveOrdering );
             }
             else
-#endif
             {
-                if ( quiescent && ( *it ).isQuiet() )
+                // Late move reductions - a quiet move this late in the order is unlikely to be best, so it is searched less
+                // deeply first, and only to the full depth if it beats alpha after all. Killers and the countermove have
+                // already shown themselves to be useful, so are left alone
+                short reduction = 0;
+                if ( lateMoveReductions && !quiescent && !inCheck && depth >= LATE_MOVE_DEPTH && count > LATE_MOVE_COUNT && move.isQuiet() && picker.getScore() < MovePicker::COUNTERMOVE )
                 {
-                    evaluation = board.scorePosition( asWhite );
+                    reduction = lateMoveReduction( depth, count );
                 }
-                else
+
+                evaluation = -negamax( board, stats, timeManager, newDepth - reduction, ply + 1, newExtensions, quiescent, -alpha - 1, -alpha, pv, moveOrdering );
+                if ( reduction > 0 && evaluation > alpha && !timeManager->hasExpired() )
                 {
-                    if ( depth == 1 && !quiescent && !( *it ).isQuiet() )
-                    {
-                        quiescent = true;
-                        depth = 5;
-                    }
-                    evaluation = minmax( board, stats, depth - 1, quiescent, alpha, beta, !maximising, asWhite, line + " " + ( *it ).toString() );
+                    evaluation = -negamax( board, stats, timeManager, newDepth, ply + 1, newExtensions, quiescent, -alpha - 1, -alpha, pv, moveOrdering );
+                }
+                if ( evaluation > alpha && evaluation < beta && !timeManager->hasExpired() )
+                {
+                    pv->clear( ply + 1 );
+                    evaluation = -negamax( board, stats, timeManager, newDepth, ply + 1, newExtensions, quiescent, -beta, -alpha, pv, moveOrdering );
                 }
             }
+        }
 
-            board.unmakeMove( undo );
+        board.unmakeMove( undo );
 
-            if ( evaluation < score )
-            {
-                score = evaluation;
-            }
-            if ( score < beta )
-            {
-                beta = score;
-            }
-            if ( score <= alpha ) // TODO try with if(beta<=alpha) as per https://www.geeksforgeeks.org/minimax-algorithm-in-game-theory-set-4-alpha-beta-pruning/
-            {
+        // Don't let the score of an interrupted search stand, and don't look at any more moves
+        if ( timeManager->hasExpired() )
+        {
+            break;
+        }
+
+        if ( evaluation > score )
+        {
+            score = evaluation;
+            bestMove = move;
+        }
+        if ( score > alpha )
+        {
+            alpha = score;
+            pv->update( ply, move );
+        }
+        if ( score >= beta )
+        {
 #ifdef SHOW_LINES
-                DEBUG( "Exiting minimising after %d/%d%s moves considered", count, moves.size(), (quiescent ? " quiescent" : "") );
+            DEBUG( "Exiting after %d/%d%s moves considered", count, moves.size(), ( quiescent ? " quiescent" : "" ) );
 #endif
-                stats->nodesExcluded += ( moves.size() - count );
-                break;
+            if ( tableNode )
+            {
+                moveOrdering->cutoff( white, ply, tableDepth, move, previousMove, moves, picker.picked() );
             }
+
+            stats->nodesExcluded += ( moves.size() - count );
+            break;
         }
+    }
+
+    stats->addNodes( moves.size() );
+
+    // Nothing picked means no legal moves, so mate or stalemate - unless in quiescence and not in check, when only some
+    // moves are generated and standing pat has given the score (so stalemate goes unnoticed there), or when the only
+    // move there is has been left out
+    if ( picker.picked() == 0 && ( !quiescent || inCheck ) && excludedMove.isNullMove() )
+    {
+        score = inCheck ? -( MATE_SCORE - ply ) : 0;
+    }
+
+    if ( tableNode && excludedMove.isNullMove() && !timeManager->hasExpired() )
+    {
+        const TranspositionTable::Bound bound = score >= beta ? TranspositionTable::Bound::LOWER : score <= alphaInput ? TranspositionTable::Bound::UPPER : TranspositionTable::Bound::EXACT;
+        transpositionTable.store( hashKey, bestMove, scoreToTable( score, ply ), tableDepth, bound );
+    }
 
 #ifdef SHOW_LINES
-        DEBUG( "5: %s scores %d", line.c_str(), score );
+    DEBUG( "4: %s scores %d", pv->pathToString( ply ).c_str(), score );
 #endif
-        return score;
-    }
+    return score;
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <iostream>
 #include <map>
@@ -7,12 +8,22 @@
 #include <optional>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "Board.h"
 #include "CopyProtection.h"
 #include "GoArguments.h"
 #include "Move.h"
+#include "MoveList.h"
+#include "MoveOrdering.h"
+#include "Nnue.h"
+#include "PawnHashTable.h"
+#include "Perft.h"
+#include "PrincipalVariation.h"
 #include "Registration.h"
+#include "ThreadPool.h"
+#include "TimeManager.h"
+#include "TranspositionTable.h"
 
 class Engine
 {
@@ -39,16 +50,70 @@ private:
 
     bool uciDebug;
 
-    volatile bool quitting;
-    volatile bool stopThinking;
+    // Set by the input thread and watched by the search threads. Neither flag guards any other data, so they are
+    // written and read with relaxed ordering - the search just has to see them soon, and waiting for the search
+    // thread to finish is what orders everything else
+    std::atomic<bool> quitting;
+    std::atomic<bool> stopThinking;
 
     std::string stagedPosition;
 
     Registration registration;
 
-    void perftDepth( const std::string& depthString, const std::string& fenString, bool divide ) const;
-    void perftFen( const std::string& fenString, bool divide ) const;
-    void perftFile( const std::string& filename, bool divide ) const;
+    // Shared by all searches and kept between them - the search itself is const, so this is mutable
+    mutable TranspositionTable transpositionTable;
+
+    // Number of threads each search uses
+    unsigned int threads;
+
+    // Selective search, each part of which can be turned off to measure what it is worth. Only read by the search, and
+    // only set by setoption, which is not sent while a search is running
+    bool nullMovePruning;
+    bool lateMoveReductions;
+    bool futilityPruning;
+
+    // Whether to evaluate with the network, when one is loaded. Set, and read, like the options above
+    bool networkEvaluation;
+
+    // The network looked for at startup, in the working directory
+    static const char* DEFAULT_EVAL_FILE;
+
+    static const unsigned int DEFAULT_THREADS;
+    static const unsigned int MAX_THREADS;
+
+    // Scores at or beyond MATE_THRESHOLD (in either direction) represent a forced mate, MATE_SCORE less the distance in plies
+    static const short MATE_SCORE;
+    static const short MATE_THRESHOLD;
+
+    // Bounds the search window - unlike std::numeric_limits<short>::lowest(), it can be negated
+    static const short INFINITE_SCORE;
+
+    /// <summary>
+    /// Convert a mate score from being relative to the root to being relative to the current node, for storing in the
+    /// transposition table - other scores are unaffected
+    /// </summary>
+    /// <param name="score">the score</param>
+    /// <param name="ply">distance from the root</param>
+    /// <returns>the adjusted score</returns>
+    static inline short scoreToTable( short score, short ply )
+    {
+        return score >= MATE_THRESHOLD ? score + ply : score <= -MATE_THRESHOLD ? score - ply : score;
+    }
+
+    /// <summary>
+    /// Reverse of scoreToTable
+    /// </summary>
+    /// <param name="score">the score from the table</param>
+    /// <param name="ply">distance from the root</param>
+    /// <returns>the adjusted score</returns>
+    static inline short scoreFromTable( short score, short ply )
+    {
+        return score >= MATE_THRESHOLD ? score - ply : score <= -MATE_THRESHOLD ? score + ply : score;
+    }
+
+    void perftDepth( const std::string& depthString, const std::string& fenString, bool divide, Perft::Generator generator ) const;
+    void perftFen( const std::string& fenString, bool divide, Perft::Generator generator ) const;
+    void perftFile( const std::string& filename, bool divide, Perft::Generator generator ) const;
 
     void resetGame( Engine& engine );
 
@@ -159,6 +224,14 @@ public:
         }
     }
 
+    /// <summary>
+    /// Whether searches evaluate with the network - the UseNNUE option is on, and there is a network loaded
+    /// </summary>
+    bool isNetworkEvaluation() const
+    {
+        return networkEvaluation && Nnue::isLoaded();
+    }
+
     void initialize();
     void run();
 
@@ -179,6 +252,8 @@ public:
     static void perftCommand( Engine& engine, const std::string& arguments );
     static void testCommand( Engine& engine, const std::string& arguments );
     static void waitCommand( Engine& engine, const std::string& arguments );
+    static void benchCommand( Engine& engine, const std::string& arguments );
+    static void stoplatencyCommand( Engine& engine, const std::string& arguments );
 
     // Broadcast - standard UCI commands
     void idBroadcast( const std::string& name, const std::string& author ) const;
@@ -190,17 +265,75 @@ public:
     void registrationBroadcast( const Registration::Status status ) const;
     void infoBroadcast( const std::string& type, const char* format, va_list args ) const;
     void infoBroadcast( const std::string&, const char* format, ... ) const;
+    void infoPvBroadcast( unsigned int depth, unsigned int selDepth, short score, size_t nodes, long long time, const PrincipalVariation& principalVariation ) const;
     void optionBroadcast( const std::string& id, bool value ) const;
+    void optionBroadcast( const std::string& id, int value, int min, int max ) const;
+    void optionBroadcast( const std::string& id, const std::string& value ) const;
 
     class Stats
     {
     public:
         size_t nodesExcluded;
-        size_t nodesTotal;
+
+        // Only ever written by the thread searching with these stats, but the main search thread reads it to total up
+        // the nodes searched by all threads
+        std::atomic<size_t> nodesTotal;
+
+        size_t tableHits;
+        unsigned short selDepth;
+
+        // Evaluations, and how many of them found their pawn structure already scored in the pawn hash table
+        size_t pawnHashProbes;
+        size_t pawnHashHits;
 
         Stats() :
             nodesExcluded( 0 ),
-            nodesTotal( 0 )
+            nodesTotal( 0 ),
+            tableHits( 0 ),
+            selDepth( 0 ),
+            pawnHashProbes( 0 ),
+            pawnHashHits( 0 )
+        {
+        }
+
+        void reset()
+        {
+            nodesExcluded = 0;
+            nodesTotal = 0;
+            tableHits = 0;
+            selDepth = 0;
+            pawnHashProbes = 0;
+            pawnHashHits = 0;
+        }
+
+        inline void addNodes( size_t count )
+        {
+            // No other thread writes this, so there's no need for an atomic add
+            nodesTotal.store( nodesTotal.load( std::memory_order_relaxed ) + count, std::memory_order_relaxed );
+        }
+    };
+
+    /// <summary>
+    /// The working state of one search thread, kept from one search to the next so that it is ready to go
+    /// </summary>
+    class ThreadData
+    {
+    public:
+        Stats stats;
+        std::unique_ptr<Board> board;
+        MoveList moves;
+        std::unique_ptr<PrincipalVariation> principalVariation;
+        std::unique_ptr<MoveOrdering> moveOrdering;
+        std::unique_ptr<PawnHashTable> pawnHashTable;
+
+        // One network accumulator for each ply the search can reach, and the root
+        std::vector<Nnue::Accumulator> accumulators;
+
+        ThreadData() :
+            principalVariation( std::make_unique<PrincipalVariation>() ),
+            moveOrdering( std::make_unique<MoveOrdering>() ),
+            pawnHashTable( std::make_unique<PawnHashTable>() ),
+            accumulators( PrincipalVariation::MAX_PLY + 1 )
         {
         }
     };
@@ -211,26 +344,57 @@ public:
         std::shared_ptr<Board> board;
         std::shared_ptr<const GoArguments> goArgs;
 
-        std::thread* workerThread;
+        // Number of threads to search with, including the main search thread
+        unsigned int threads;
+
+        // The engine whose thread pool is running this search, once it has been run
+        const Engine* runningEngine;
+
+        /// <summary>
+        /// Iterative deepening search of the root moves, run by the main search thread and by each helper thread. Only the
+        /// main thread (thread zero) manages the time and reports progress; helpers skip some depths
+        /// </summary>
+        /// <param name="engine">the engine</param>
+        /// <param name="board">this thread's copy of the position</param>
+        /// <param name="moves">the root moves, reordered as the search goes</param>
+        /// <param name="stats">this thread's stats</param>
+        /// <param name="timeManager">this thread's time manager</param>
+        /// <param name="principalVariation">this thread's principal variation table</param>
+        /// <param name="moveOrdering">this thread's killers, history and countermoves</param>
+        /// <param name="maxDepth">the deepest iteration to run</param>
+        /// <param name="thread">the thread number, zero for the main thread</param>
+        /// <param name="helperStats">stats of the helper threads, to total up the nodes reported by the main thread</param>
+        /// <param name="bestMove">set to the best move found</param>
+        /// <param name="bestScore">set to the score of the best move</param>
+        static void iterate( const Engine* engine, Board& board, MoveList& moves, Stats* stats, TimeManager* timeManager, PrincipalVariation* principalVariation, MoveOrdering* moveOrdering, unsigned int maxDepth, unsigned int thread, const std::vector<const Stats*>* helperStats, Move& bestMove, short& bestScore );
 
     public:
-        Search( Board& board, const GoArguments& goArgs );
+        Search( Board& board, const GoArguments& goArgs, unsigned int threads = 1 );
 
         static void start( const Engine* engine, const Search* search, Stats* stats, const std::function<void( const Move&, const Move& )>& bestMoveHandler );
 
         Engine::Stats stats;
 
+        /// <summary>
+        /// Start the search on the engine's main search thread, broadcasting the best move when done
+        /// </summary>
+        /// <param name="engine">the engine</param>
         void run( const Engine* engine );
 
+        /// <summary>
+        /// Start the search on the engine's main search thread, passing the best move to a handler when done
+        /// </summary>
+        /// <param name="engine">the engine</param>
+        /// <param name="bestMoveHandler">called with the best move and any move to ponder on</param>
+        void run( const Engine* engine, const std::function<void( const Move&, const Move& )>& bestMoveHandler );
+
         void wait()
         {
-            if ( workerThread != nullptr )
+            if ( runningEngine != nullptr )
             {
-                workerThread->join();
+                runningEngine->threadPool.wait( 0 );
 
-                delete workerThread;
-
-                workerThread = nullptr;
+                runningEngine = nullptr;
             }
         }
     };
@@ -238,6 +402,47 @@ public:
     Engine::Search* currentSearch;
 
 private:
-    short quiesce( Board& board, short depth, short alphaInput, short betaInput, bool maximising, bool asWhite, std::string line ) const;
-    short minmax( Board& board, Stats* stats, short depth, bool quiescent, short alphaInput, short betaInput, bool maximising, bool asWhite, std::string line ) const;
+    // Search threads and their working state, kept for the life of the engine. Thread zero runs the main search and the
+    // others are helpers. The threads are declared last so that they are stopped before the state they use is destroyed
+    mutable std::vector<std::unique_ptr<ThreadData>> threadData;
+    mutable ThreadPool threadPool;
+
+    /// <summary>
+    /// Make sure there are enough search threads, and working state for them. Only call this while no search is running
+    /// </summary>
+    /// <param name="count">the number of threads needed, including the main search thread</param>
+    void prepareThreads( unsigned int count ) const;
+
+    /// <summary>
+    /// Move the transposition table move, if there is one and it is in the list, to the front of the list
+    /// </summary>
+    /// <param name="moves">the moves to order</param>
+    /// <param name="tableMove">the move from the table, possibly the null move</param>
+    static void orderTableMove( MoveList& moves, const Move& tableMove );
+
+    /// <summary>
+    /// How much to reduce the depth of a late quiet move - more the deeper the search and the later the move
+    /// </summary>
+    /// <param name="depth">remaining depth</param>
+    /// <param name="moveNumber">the position of the move in the order searched, from 1</param>
+    /// <returns>the number of plies to reduce by</returns>
+    static short lateMoveReduction( short depth, int moveNumber );
+
+    /// <summary>
+    /// Principal variation search of a position, in negamax form - scores are from the point of view of the side to move
+    /// </summary>
+    /// <param name="board">the position, which is returned to as it was</param>
+    /// <param name="stats">this thread's stats</param>
+    /// <param name="timeManager">this thread's time manager</param>
+    /// <param name="depth">remaining depth</param>
+    /// <param name="ply">distance from the root</param>
+    /// <param name="extensions">plies of extension already used on the line to this position</param>
+    /// <param name="quiescent">whether only captures, promotions and checks are being searched</param>
+    /// <param name="alphaInput">the score the side to move is already sure of</param>
+    /// <param name="betaInput">the score the opponent is already sure of holding the side to move to</param>
+    /// <param name="pv">this thread's principal variation table</param>
+    /// <param name="moveOrdering">this thread's killers, history and countermoves</param>
+    /// <param name="excludedMove">a move to leave out, when showing whether the table move is singular, or the null move</param>
+    /// <returns>the score, which is only a bound if it is outside the window</returns>
+    short negamax( Board& board, Stats* stats, TimeManager* timeManager, short depth, short ply, short extensions, bool quiescent, short alphaInput, short betaInput, PrincipalVariation* pv, MoveOrdering* moveOrdering, const Move& excludedMove = Move::nullMove ) const;
 };
\ No newline at end of file
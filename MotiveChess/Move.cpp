@@ -32,10 +32,12 @@ const unsigned long Move::MOVING_QUEEN     = 0b00000000010100000000000000000000;
 const unsigned long Move::MOVING_KING      = 0b00000000011000000000000000000000;
 
 const unsigned long Move::CAPTURE_PIECE    = 0b00000011100000000000000000000000;
-const unsigned long Move::CAPTURE_KNIGHT   = 0b00000010000000000000000000000000;
-const unsigned long Move::CAPTURE_BISHOP   = 0b00000010100000000000000000000000;
-const unsigned long Move::CAPTURE_ROOK     = 0b00000011000000000000000000000000;
-const unsigned long Move::CAPTURE_QUEEN    = 0b00000011100000000000000000000000;
+const unsigned long Move::CAPTURE_PAWN     = 0b00000000100000000000000000000000;
+const unsigned long Move::CAPTURE_KNIGHT   = 0b00000001000000000000000000000000;
+const unsigned long Move::CAPTURE_BISHOP   = 0b00000001100000000000000000000000;
+const unsigned long Move::CAPTURE_ROOK     = 0b00000010000000000000000000000000;
+const unsigned long Move::CAPTURE_QUEEN    = 0b00000010100000000000000000000000;
+const unsigned long Move::CAPTURE_KING     = 0b00000011000000000000000000000000;
 
 const unsigned long Move::NON_QUIESCENT    = PROMOTION_MASK | CAPTURE | CASTLING_MASK | CHECKING_MASK;
 const unsigned long Move::COMPARABLE_MASK  = PROMOTION_MASK | FROM_MASK | TO_MASK;
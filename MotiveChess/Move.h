@@ -58,6 +58,11 @@ public:
 
     static const Move nullMove;
 
+    /// <summary>
+    /// Leaves the move uninitialised, so that a fixed size move list can be created without writing to every slot
+    /// </summary>
+    Move() = default;
+
     Move( const char* moveString );
 
     Move( unsigned long from, unsigned long to, unsigned long extraBits = 0 );
@@ -79,11 +84,16 @@ public:
     /// </summary>
     /// <param name="other"></param>
     /// <returns></returns>
-    bool isEquivalent( const Move& other )
+    bool isEquivalent( const Move& other ) const
     {
         return ( moveBits & COMPARABLE_MASK ) == ( other.moveBits & COMPARABLE_MASK );
     }
 
+    inline unsigned long getBits() const
+    {
+        return moveBits;
+    }
+
     inline unsigned short getFrom() const
     {
         return ( moveBits >> 6 ) & 0b0000000000111111;
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+#include "Move.h"
+
+/// <summary>
+/// A list of moves with fixed, inline storage - enough for any legal position - so that generating moves at a
+/// node doesn't need a heap allocation. Each move has a score alongside it for ordering
+/// </summary>
+class MoveList
+{
+public:
+    typedef Move* iterator;
+    typedef const Move* const_iterator;
+
+    // No legal position has more than 218 moves
+    static const size_t MAX_MOVES = 256;
+
+private:
+    std::array<Move, MAX_MOVES> moves;
+    std::array<int, MAX_MOVES> scores;
+
+    size_t count;
+
+public:
+    MoveList() :
+        count( 0 )
+    {
+    }
+
+    inline void push_back( const Move& move )
+    {
+        moves[ count++ ] = move;
+    }
+
+    inline void pop_back()
+    {
+        count--;
+    }
+
+    inline size_t size() const
+    {
+        return count;
+    }
+
+    inline bool empty() const
+    {
+        return count == 0;
+    }
+
+    inline void clear()
+    {
+        count = 0;
+    }
+
+    inline Move& operator[]( size_t index )
+    {
+        return moves[ index ];
+    }
+
+    inline const Move& operator[]( size_t index ) const
+    {
+        return moves[ index ];
+    }
+
+    inline iterator begin()
+    {
+        return moves.data();
+    }
+
+    inline iterator end()
+    {
+        return moves.data() + count;
+    }
+
+    inline const_iterator begin() const
+    {
+        return moves.data();
+    }
+
+    inline const_iterator end() const
+    {
+        return moves.data() + count;
+    }
+
+    inline const_iterator cbegin() const
+    {
+        return moves.data();
+    }
+
+    inline const_iterator cend() const
+    {
+        return moves.data() + count;
+    }
+
+    inline int getScore( size_t index ) const
+    {
+        return scores[ index ];
+    }
+
+    inline void setScore( size_t index, int score )
+    {
+        scores[ index ] = score;
+    }
+
+    /// <summary>
+    /// Remove a move, keeping the order of those after it
+    /// </summary>
+    /// <param name="it">the move to remove</param>
+    /// <returns>the move that now follows the removed one</returns>
+    iterator erase( iterator it )
+    {
+        const size_t index = it - begin();
+
+        for ( size_t loop = index + 1; loop < count; loop++ )
+        {
+            moves[ loop - 1 ] = moves[ loop ];
+            scores[ loop - 1 ] = scores[ loop ];
+        }
+        count--;
+
+        return begin() + index;
+    }
+
+    /// <summary>
+    /// Exchange two entries
+    /// </summary>
+    inline void swap( size_t first, size_t second )
+    {
+        std::swap( moves[ first ], moves[ second ] );
+        std::swap( scores[ first ], scores[ second ] );
+    }
+
+    /// <summary>
+    /// Move one entry to the front of the list, keeping the order of the others
+    /// </summary>
+    /// <param name="index">the entry to move</param>
+    void moveToFront( size_t index )
+    {
+        const Move move = moves[ index ];
+        const int score = scores[ index ];
+
+        for ( size_t loop = index; loop > 0; loop-- )
+        {
+            moves[ loop ] = moves[ loop - 1 ];
+            scores[ loop ] = scores[ loop - 1 ];
+        }
+
+        moves[ 0 ] = move;
+        scores[ 0 ] = score;
+    }
+
+    /// <summary>
+    /// Order the moves by score, highest first. Moves with equal scores keep their generated order.
+    /// Lists are short, so an insertion sort does fine here
+    /// </summary>
+    void sortByScore()
+    {
+        for ( size_t loop = 1; loop < count; loop++ )
+        {
+            const Move move = moves[ loop ];
+            const int score = scores[ loop ];
+
+            size_t insert = loop;
+            while ( insert > 0 && scores[ insert - 1 ] < score )
+            {
+                moves[ insert ] = moves[ insert - 1 ];
+                scores[ insert ] = scores[ insert - 1 ];
+                insert--;
+            }
+
+            moves[ insert ] = move;
+            scores[ insert ] = score;
+        }
+    }
+};
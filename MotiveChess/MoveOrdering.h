@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+
+#include "Move.h"
+#include "MoveList.h"
+#include "PrincipalVariation.h"
+
+/// <summary>
+/// What a search thread has learnt about which quiet moves cause cut-offs, for ordering the quiet moves at other nodes.
+/// Killers are the quiet moves that last caused a cut-off at the same ply elsewhere in the tree, the history table
+/// scores each from and to square pair, for each side, by the cut-offs it has caused, and the countermove table
+/// remembers the quiet move that last refuted each move
+/// </summary>
+class MoveOrdering
+{
+public:
+    // History scores are kept within plus or minus this
+    static const int HISTORY_MAX = 16384;
+
+    // Killer slots per ply
+    static const size_t KILLERS = 2;
+
+private:
+    std::array<std::array<Move, KILLERS>, PrincipalVariation::MAX_PLY> killers;
+    std::array<std::array<std::array<int, 64>, 64>, 2> history;
+    std::array<std::array<Move, 64>, 64> countermoves;
+
+    /// <summary>
+    /// Nudge a history score, by less the nearer it is to the limit in that direction, so that it never passes it and
+    /// recent results count for more than old ones
+    /// </summary>
+    inline void adjustHistory( bool white, const Move& move, int bonus )
+    {
+        int& entry = history[ white ? 0 : 1 ][ move.getFrom() ][ move.getTo() ];
+        entry += bonus - entry * std::abs( bonus ) / HISTORY_MAX;
+    }
+
+    inline static bool isQuietMove( const Move& move )
+    {
+        return !move.isCapture() && !move.isPromotion();
+    }
+
+public:
+    MoveOrdering()
+    {
+        clear();
+    }
+
+    /// <summary>
+    /// Forget everything - e.g. for a new game
+    /// </summary>
+    void clear()
+    {
+        for ( std::array<Move, KILLERS>& plyKillers : killers )
+        {
+            plyKillers.fill( Move::nullMove );
+        }
+        for ( std::array<std::array<int, 64>, 64>& side : history )
+        {
+            for ( std::array<int, 64>& from : side )
+            {
+                from.fill( 0 );
+            }
+        }
+        for ( std::array<Move, 64>& from : countermoves )
+        {
+            from.fill( Move::nullMove );
+        }
+    }
+
+    /// <summary>
+    /// Ready for the next search. Killers belong to plies of the last search's tree, so are dropped. History is still a
+    /// good guide, but is aged so that the new search can soon make its own mark
+    /// </summary>
+    void newSearch()
+    {
+        for ( std::array<Move, KILLERS>& plyKillers : killers )
+        {
+            plyKillers.fill( Move::nullMove );
+        }
+        for ( std::array<std::array<int, 64>, 64>& side : history )
+        {
+            for ( std::array<int, 64>& from : side )
+            {
+                for ( int& entry : from )
+                {
+                    entry /= 2;
+                }
+            }
+        }
+    }
+
+    inline const Move& getKiller( size_t ply, size_t slot ) const
+    {
+        return killers[ ply ][ slot ];
+    }
+
+    inline int getHistory( bool white, const Move& move ) const
+    {
+        return history[ white ? 0 : 1 ][ move.getFrom() ][ move.getTo() ];
+    }
+
+    /// <summary>
+    /// The quiet move that last refuted a move
+    /// </summary>
+    /// <param name="previousMove">the move made to reach the current position</param>
+    /// <returns>the refutation, or the null move if there isn't one</returns>
+    inline const Move& getCountermove( const Move& previousMove ) const
+    {
+        return countermoves[ previousMove.getFrom() ][ previousMove.getTo() ];
+    }
+
+    /// <summary>
+    /// Learn from a cut-off. Only quiet moves are remembered, as captures are already ordered well enough by what they
+    /// capture. The quiet moves searched before it failed to cut off, so their history counts against them
+    /// </summary>
+    /// <param name="white">whether white made the move</param>
+    /// <param name="ply">distance from the root</param>
+    /// <param name="depth">remaining depth at the node, so that deeper cut-offs count for more</param>
+    /// <param name="move">the move that caused the cut-off</param>
+    /// <param name="previousMove">the move made to reach the node, or the null move at the root</param>
+    /// <param name="moves">the moves at the node, with those already searched at the start</param>
+    /// <param name="searched">the number of moves searched, including the one that caused the cut-off</param>
+    void cutoff( bool white, size_t ply, short depth, const Move& move, const Move& previousMove, const MoveList& moves, size_t searched )
+    {
+        if ( !isQuietMove( move ) )
+        {
+            return;
+        }
+
+        if ( !killers[ ply ][ 0 ].isEquivalent( move ) )
+        {
+            for ( size_t slot = KILLERS - 1; slot > 0; slot-- )
+            {
+                killers[ ply ][ slot ] = killers[ ply ][ slot - 1 ];
+            }
+            killers[ ply ][ 0 ] = move;
+        }
+
+        if ( !previousMove.isNullMove() )
+        {
+            countermoves[ previousMove.getFrom() ][ previousMove.getTo() ] = move;
+        }
+
+        const int bonus = depth * depth;
+
+        adjustHistory( white, move, bonus );
+        for ( size_t loop = 0; loop + 1 < searched; loop++ )
+        {
+            if ( isQuietMove( moves[ loop ] ) )
+            {
+                adjustHistory( white, moves[ loop ], -bonus );
+            }
+        }
+    }
+};
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <limits>
+
+#include "Board.h"
+#include "Move.h"
+#include "MoveList.h"
+#include "MoveOrdering.h"
+
+/// <summary>
+/// Hands out the moves at a node best first, in stages: the transposition table move, captures and promotions that
+/// don't lose material (by MVV-LVA), the killers and the countermove, the other quiet moves by history, and last of all
+/// the captures that lose material. Moves are only generated when the stage before has run out - the table move,
+/// killers and countermove are checked for legality on their own - so a node that cuts off early may never generate
+/// its quiet moves at all. Within a stage, each move is picked from those left when it is asked for.
+/// In quiescence the moves are few, so they are all generated at once and then picked in the same way
+/// </summary>
+class MovePicker
+{
+public:
+    // Scores for the moves handed out ahead of the generated moves, fitted around those from Board::scoreMoves - which
+    // puts captures that don't lose material from 1 << 28, quiet moves below 1 << 24 and captures that lose material
+    // below zero
+    static const int TABLE_MOVE = std::numeric_limits<int>::max();
+    static const int KILLER = 1 << 27;
+    static const int COUNTERMOVE = 1 << 26;
+
+private:
+    enum class Stage
+    {
+        TABLE_MOVE,
+        GENERATE_CAPTURES,
+        WINNING_CAPTURES,
+        REFUTATIONS,
+        GENERATE_QUIETS,
+        REMAINING,
+        GENERATE_QUIESCENT
+    };
+
+    // Killers and the countermove
+    static const size_t REFUTATIONS = MoveOrdering::KILLERS + 1;
+
+    Board& board;
+    MoveList& moves;
+    const MoveOrdering* moveOrdering;
+
+    Stage stage;
+
+    // Moves already handed out are at the front of the list, and those still to pick from after them
+    size_t current;
+    bool ready;
+
+    // Moves handed out before generation, which the generator will produce again
+    Move tableMove;
+    std::array<Move, REFUTATIONS> refutations;
+    size_t refutationCount;
+    size_t refutationIndex;
+
+    /// <summary>
+    /// Bring the best of the moves left to the front of them
+    /// </summary>
+    /// <returns>false if there are none left</returns>
+    inline bool select()
+    {
+        if ( current >= moves.size() )
+        {
+            return false;
+        }
+
+        size_t best = current;
+        for ( size_t loop = current + 1; loop < moves.size(); loop++ )
+        {
+            if ( moves.getScore( loop ) > moves.getScore( best ) )
+            {
+                best = loop;
+            }
+        }
+
+        moves.swap( current, best );
+
+        return true;
+    }
+
+    /// <summary>
+    /// Whether a move has been handed out already, ahead of generation
+    /// </summary>
+    inline bool isHandedOut( const Move& move ) const
+    {
+        if ( !tableMove.isNullMove() && move.isEquivalent( tableMove ) )
+        {
+            return true;
+        }
+
+        for ( size_t loop = 0; loop < refutationIndex; loop++ )
+        {
+            if ( move.isEquivalent( refutations[ loop ] ) )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// <summary>
+    /// Drop newly generated moves that have been handed out already
+    /// </summary>
+    /// <param name="first">the first of the newly generated moves</param>
+    void removeHandedOut( size_t first )
+    {
+        for ( size_t loop = first; loop < moves.size(); )
+        {
+            if ( isHandedOut( moves[ loop ] ) )
+            {
+                moves.swap( loop, moves.size() - 1 );
+                moves.pop_back();
+            }
+            else
+            {
+                loop++;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Score newly generated moves, keeping the contextual order from the board - checks first - for quiet moves, with
+    /// history to separate the rest
+    /// </summary>
+    /// <param name="first">the first of the newly generated moves</param>
+    void scoreGenerated( size_t first )
+    {
+        board.scoreMoves( moves, first );
+
+        const bool white = board.whiteToPlay();
+        for ( size_t loop = first; loop < moves.size(); loop++ )
+        {
+            const Move& move = moves[ loop ];
+            if ( !move.isCapture() && !move.isPromotion() )
+            {
+                moves.setScore( loop, moves.getScore( loop ) + moveOrdering->getHistory( white, move ) + MoveOrdering::HISTORY_MAX );
+            }
+        }
+    }
+
+    /// <summary>
+    /// Put a move handed out ahead of generation at the front of the moves left
+    /// </summary>
+    inline void handOut( const Move& move, int score )
+    {
+        moves.push_back( move );
+        moves.setScore( moves.size() - 1, score );
+        moves.swap( current, moves.size() - 1 );
+    }
+
+public:
+    /// <summary>
+    /// Ready to pick moves - nothing is generated until the first move is asked for
+    /// </summary>
+    /// <param name="board">the position the moves are for, which must be back in this position whenever a move is asked for</param>
+    /// <param name="moves">an empty list, to hold the moves as they are generated and picked</param>
+    /// <param name="quiescent">whether to pick from the quiescence moves only</param>
+    /// <param name="tableMove">the best move from the transposition table, or the null move</param>
+    /// <param name="moveOrdering">the search thread's killers, history and countermoves</param>
+    /// <param name="ply">distance from the root</param>
+    /// <param name="previousMove">the move made to reach this position, or the null move at the root</param>
+    MovePicker( Board& board, MoveList& moves, bool quiescent, const Move& tableMove, const MoveOrdering* moveOrdering, size_t ply, const Move& previousMove ) :
+        board( board ),
+        moves( moves ),
+        moveOrdering( moveOrdering ),
+        stage( quiescent ? Stage::GENERATE_QUIESCENT : Stage::TABLE_MOVE ),
+        current( 0 ),
+        ready( false ),
+        tableMove( tableMove ),
+        refutationCount( 0 ),
+        refutationIndex( 0 )
+    {
+        if ( quiescent )
+        {
+            return;
+        }
+
+        for ( size_t slot = 0; slot < MoveOrdering::KILLERS; slot++ )
+        {
+            refutations[ refutationCount++ ] = moveOrdering->getKiller( ply, slot );
+        }
+        refutations[ refutationCount++ ] = previousMove.isNullMove() ? Move::nullMove : moveOrdering->getCountermove( previousMove );
+    }
+
+    /// <summary>
+    /// Never hand out the table move - for a search of every move but that one. It is still kept out of the moves
+    /// generated later
+    /// </summary>
+    inline void excludeTableMove()
+    {
+        if ( stage == Stage::TABLE_MOVE )
+        {
+            stage = Stage::GENERATE_CAPTURES;
+        }
+    }
+
+    /// <summary>
+    /// Whether there is another move, generating more moves if needed
+    /// </summary>
+    bool hasNext()
+    {
+        while ( !ready )
+        {
+            switch ( stage )
+            {
+            case Stage::TABLE_MOVE:
+                stage = Stage::GENERATE_CAPTURES;
+
+                if ( board.validateMove( tableMove ) )
+                {
+                    handOut( tableMove, TABLE_MOVE );
+                    ready = true;
+                }
+                else
+                {
+                    tableMove = Move::nullMove;
+                }
+                break;
+
+            case Stage::GENERATE_CAPTURES:
+            {
+                const size_t first = moves.size();
+                board.getCaptures( moves );
+                removeHandedOut( first );
+                scoreGenerated( first );
+
+                stage = Stage::WINNING_CAPTURES;
+                break;
+            }
+
+            case Stage::WINNING_CAPTURES:
+                // Captures that lose material wait until after the quiet moves
+                if ( select() && moves.getScore( current ) >= 0 )
+                {
+                    ready = true;
+                }
+                else
+                {
+                    stage = Stage::REFUTATIONS;
+                }
+                break;
+
+            case Stage::REFUTATIONS:
+                while ( !ready && refutationIndex < refutationCount )
+                {
+                    Move& move = refutations[ refutationIndex ];
+
+                    // A killer or countermove from another position may not be legal here, or may be a capture here
+                    // and so already picked up with the captures - and killers and countermove may be the same move
+                    bool useful = !move.isNullMove() && !isHandedOut( move ) && board.validateMove( move ) && !move.isCapture() && !move.isPromotion();
+                    if ( useful )
+                    {
+                        handOut( move, refutationIndex < MoveOrdering::KILLERS ? KILLER + static_cast<int>( MoveOrdering::KILLERS - refutationIndex ) : COUNTERMOVE );
+                        ready = true;
+                    }
+                    else
+                    {
+                        move = Move::nullMove;
+                    }
+
+                    refutationIndex++;
+                }
+
+                if ( !ready )
+                {
+                    stage = Stage::GENERATE_QUIETS;
+                }
+                break;
+
+            case Stage::GENERATE_QUIETS:
+            {
+                const size_t first = moves.size();
+                board.getQuietMoves( moves );
+                removeHandedOut( first );
+                scoreGenerated( first );
+
+                stage = Stage::REMAINING;
+                break;
+            }
+
+            case Stage::GENERATE_QUIESCENT:
+                board.getQuiescentMoves( moves );
+                scoreGenerated( 0 );
+
+                stage = Stage::REMAINING;
+                break;
+
+            case Stage::REMAINING:
+                // Quiet moves score from zero up, so come before the captures that lose material
+                if ( !select() )
+                {
+                    return false;
+                }
+
+                ready = true;
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// The next move, best first. Only call this once hasNext has said there is one
+    /// </summary>
+    /// <returns>the move</returns>
+    inline const Move& next()
+    {
+        ready = false;
+
+        return moves[ current++ ];
+    }
+
+    /// <summary>
+    /// The score of the move last picked
+    /// </summary>
+    inline int getScore() const
+    {
+        return moves.getScore( current - 1 );
+    }
+
+    /// <summary>
+    /// The number of moves picked so far, which are at the front of the list in the order they were picked
+    /// </summary>
+    inline size_t picked() const
+    {
+        return current;
+    }
+};
@@ -0,0 +1,234 @@
+#include "Nnue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef USE_AVX2
+#include <immintrin.h>
+#endif
+
+const char Nnue::MAGIC[ 4 ] = { 'M', 'C', 'N', 'N' };
+
+bool Nnue::loaded = false;
+std::string Nnue::loadedFile;
+
+std::vector<short> Nnue::featureBiases;
+std::vector<short> Nnue::featureWeights;
+
+std::vector<int> Nnue::layer2Biases;
+std::vector<signed char> Nnue::layer2Weights;
+std::vector<int> Nnue::layer3Biases;
+std::vector<signed char> Nnue::layer3Weights;
+int Nnue::outputBias = 0;
+std::vector<signed char> Nnue::outputWeights;
+
+bool Nnue::load( const std::string& filename )
+{
+    std::ifstream file( filename, std::ios::binary );
+    if ( !file.is_open() )
+    {
+        return false;
+    }
+
+    // Everything is little-endian, which is also how it is held in memory on the platforms this builds for
+    auto read = [&file] ( auto& values ) -> bool
+    {
+        return static_cast<bool>( file.read( reinterpret_cast<char*>( values.data() ), values.size() * sizeof( values[ 0 ] ) ) );
+    };
+
+    char magic[ 4 ];
+    unsigned int header[ 5 ];
+    if ( !file.read( magic, sizeof( magic ) ) || !file.read( reinterpret_cast<char*>( header ), sizeof( header ) ) )
+    {
+        return false;
+    }
+
+    if ( std::memcmp( magic, MAGIC, sizeof( magic ) ) != 0 || header[ 0 ] != VERSION ||
+         header[ 1 ] != INPUTS || header[ 2 ] != HIDDEN || header[ 3 ] != LAYER2 || header[ 4 ] != LAYER3 )
+    {
+        return false;
+    }
+
+    // Read into new storage, so that a bad file leaves the current network alone
+    std::vector<short> newFeatureBiases( HIDDEN );
+    std::vector<short> newFeatureWeights( static_cast<size_t>( INPUTS ) * HIDDEN );
+    std::vector<int> newLayer2Biases( LAYER2 );
+    std::vector<signed char> newLayer2Weights( LAYER2 * 2 * HIDDEN );
+    std::vector<int> newLayer3Biases( LAYER3 );
+    std::vector<signed char> newLayer3Weights( LAYER3 * LAYER2 );
+    std::vector<int> newOutputBias( 1 );
+    std::vector<signed char> newOutputWeights( LAYER3 );
+
+    if ( !read( newFeatureBiases ) || !read( newFeatureWeights ) ||
+         !read( newLayer2Biases ) || !read( newLayer2Weights ) ||
+         !read( newLayer3Biases ) || !read( newLayer3Weights ) ||
+         !read( newOutputBias ) || !read( newOutputWeights ) )
+    {
+        return false;
+    }
+
+    // Nothing should follow
+    if ( file.peek() != std::ifstream::traits_type::eof() )
+    {
+        return false;
+    }
+
+    featureBiases = std::move( newFeatureBiases );
+    featureWeights = std::move( newFeatureWeights );
+    layer2Biases = std::move( newLayer2Biases );
+    layer2Weights = std::move( newLayer2Weights );
+    layer3Biases = std::move( newLayer3Biases );
+    layer3Weights = std::move( newLayer3Weights );
+    outputBias = newOutputBias[ 0 ];
+    outputWeights = std::move( newOutputWeights );
+
+    loaded = true;
+    loadedFile = filename;
+
+    return true;
+}
+
+void Nnue::refresh( short* values, const unsigned int* features, unsigned int count )
+{
+    std::copy( featureBiases.begin(), featureBiases.end(), values );
+
+    for ( unsigned int feature = 0; feature < count; feature++ )
+    {
+        const short* weights = &featureWeights[ static_cast<size_t>( features[ feature ] ) * HIDDEN ];
+
+#ifdef USE_AVX2
+        for ( unsigned int index = 0; index < HIDDEN; index += 16 )
+        {
+            const __m256i sum = _mm256_add_epi16( _mm256_load_si256( reinterpret_cast<const __m256i*>( values + index ) ),
+                                                  _mm256_loadu_si256( reinterpret_cast<const __m256i*>( weights + index ) ) );
+            _mm256_store_si256( reinterpret_cast<__m256i*>( values + index ), sum );
+        }
+#else
+        for ( unsigned int index = 0; index < HIDDEN; index++ )
+        {
+            values[ index ] += weights[ index ];
+        }
+#endif
+    }
+}
+
+void Nnue::update( short* values, const short* previous, const unsigned int* added, unsigned int addedCount, const unsigned int* removed, unsigned int removedCount )
+{
+#ifdef USE_AVX2
+    // Sixteen values at a time, each kept in a register while every change is applied to it
+    for ( unsigned int index = 0; index < HIDDEN; index += 16 )
+    {
+        __m256i sum = _mm256_load_si256( reinterpret_cast<const __m256i*>( previous + index ) );
+
+        for ( unsigned int feature = 0; feature < addedCount; feature++ )
+        {
+            const short* weights = &featureWeights[ static_cast<size_t>( added[ feature ] ) * HIDDEN + index ];
+            sum = _mm256_add_epi16( sum, _mm256_loadu_si256( reinterpret_cast<const __m256i*>( weights ) ) );
+        }
+        for ( unsigned int feature = 0; feature < removedCount; feature++ )
+        {
+            const short* weights = &featureWeights[ static_cast<size_t>( removed[ feature ] ) * HIDDEN + index ];
+            sum = _mm256_sub_epi16( sum, _mm256_loadu_si256( reinterpret_cast<const __m256i*>( weights ) ) );
+        }
+
+        _mm256_store_si256( reinterpret_cast<__m256i*>( values + index ), sum );
+    }
+#else
+    std::copy( previous, previous + HIDDEN, values );
+
+    for ( unsigned int feature = 0; feature < addedCount; feature++ )
+    {
+        const short* weights = &featureWeights[ static_cast<size_t>( added[ feature ] ) * HIDDEN ];
+        for ( unsigned int index = 0; index < HIDDEN; index++ )
+        {
+            values[ index ] += weights[ index ];
+        }
+    }
+    for ( unsigned int feature = 0; feature < removedCount; feature++ )
+    {
+        const short* weights = &featureWeights[ static_cast<size_t>( removed[ feature ] ) * HIDDEN ];
+        for ( unsigned int index = 0; index < HIDDEN; index++ )
+        {
+            values[ index ] -= weights[ index ];
+        }
+    }
+#endif
+}
+
+void Nnue::clip( const short* values, unsigned char* output )
+{
+#ifdef USE_AVX2
+    const __m256i zero = _mm256_setzero_si256();
+    for ( unsigned int index = 0; index < HIDDEN; index += 32 )
+    {
+        // Packing saturates to -128-127, and works within each 128-bit half - so put the halves back in order afterwards
+        const __m256i low = _mm256_load_si256( reinterpret_cast<const __m256i*>( values + index ) );
+        const __m256i high = _mm256_load_si256( reinterpret_cast<const __m256i*>( values + index + 16 ) );
+        const __m256i packed = _mm256_permute4x64_epi64( _mm256_packs_epi16( low, high ), 0b11011000 );
+
+        _mm256_store_si256( reinterpret_cast<__m256i*>( output + index ), _mm256_max_epi8( packed, zero ) );
+    }
+#else
+    for ( unsigned int index = 0; index < HIDDEN; index++ )
+    {
+        output[ index ] = static_cast<unsigned char>( std::clamp<int>( values[ index ], 0, 127 ) );
+    }
+#endif
+}
+
+int Nnue::dot( const unsigned char* input, const signed char* weights, unsigned int length )
+{
+#ifdef USE_AVX2
+    // Inputs are at most 127, so the pairs of products summed to 16 bits can't saturate
+    const __m256i ones = _mm256_set1_epi16( 1 );
+    __m256i sum = _mm256_setzero_si256();
+    for ( unsigned int index = 0; index < length; index += 32 )
+    {
+        const __m256i products = _mm256_maddubs_epi16( _mm256_load_si256( reinterpret_cast<const __m256i*>( input + index ) ),
+                                                       _mm256_loadu_si256( reinterpret_cast<const __m256i*>( weights + index ) ) );
+        sum = _mm256_add_epi32( sum, _mm256_madd_epi16( products, ones ) );
+    }
+
+    __m128i total = _mm_add_epi32( _mm256_castsi256_si128( sum ), _mm256_extracti128_si256( sum, 1 ) );
+    total = _mm_add_epi32( total, _mm_shuffle_epi32( total, 0b01001110 ) );
+    total = _mm_add_epi32( total, _mm_shuffle_epi32( total, 0b10110001 ) );
+
+    return _mm_cvtsi128_si32( total );
+#else
+    int sum = 0;
+    for ( unsigned int index = 0; index < length; index++ )
+    {
+        sum += input[ index ] * weights[ index ];
+    }
+
+    return sum;
+#endif
+}
+
+void Nnue::hiddenLayer( const unsigned char* input, unsigned int inputs, const std::vector<int>& biases, const std::vector<signed char>& weights, unsigned char* output, unsigned int outputs )
+{
+    for ( unsigned int neuron = 0; neuron < outputs; neuron++ )
+    {
+        const int sum = biases[ neuron ] + dot( input, &weights[ neuron * inputs ], inputs );
+
+        output[ neuron ] = static_cast<unsigned char>( std::clamp( sum >> WEIGHT_SHIFT, 0, 127 ) );
+    }
+}
+
+short Nnue::evaluate( const Accumulator& accumulator, unsigned short perspective )
+{
+    alignas( 32 ) unsigned char input[ 2 * HIDDEN ];
+    alignas( 32 ) unsigned char layer2[ LAYER2 ];
+    alignas( 32 ) unsigned char layer3[ LAYER3 ];
+
+    clip( accumulator.values[ perspective ], input );
+    clip( accumulator.values[ perspective ^ 1 ], input + HIDDEN );
+
+    hiddenLayer( input, 2 * HIDDEN, layer2Biases, layer2Weights, layer2, LAYER2 );
+    hiddenLayer( layer2, LAYER2, layer3Biases, layer3Weights, layer3, LAYER3 );
+
+    const int output = outputBias + dot( layer3, outputWeights.data(), LAYER3 );
+
+    return static_cast<short>( std::clamp( output / OUTPUT_SCALE, -10000, 10000 ) );
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/// <summary>
+/// An efficiently updatable neural network evaluator. The first layer takes HalfKP features - for each side's point of
+/// view, where its own king is and where every other piece is - and, as only a few of these change with each move, its
+/// output (the accumulator) is updated from the position before rather than worked out again. The rest of the network
+/// is small, with 8-bit weights, and is run in full for each evaluation.
+/// Pieces are given by bitboard array index, as used by Board: 1 to 6 for white pawn to king and 7 to 12 for black
+/// </summary>
+class Nnue
+{
+public:
+    // HalfKP inputs, per perspective - each square of that side's own king, by each non-king piece of either colour
+    // (own pieces first) on each square
+    static const unsigned int PIECE_SQUARES = 10 * 64;
+    static const unsigned int INPUTS = 64 * PIECE_SQUARES;
+
+    // Layer sizes. The accumulator holds HIDDEN values for each perspective, and both go into the next layer - the side
+    // to move's first
+    static const unsigned int HIDDEN = 256;
+    static const unsigned int LAYER2 = 32;
+    static const unsigned int LAYER3 = 32;
+
+    /// <summary>
+    /// The first layer's output for a position, for white's point of view and then for black's
+    /// </summary>
+    class alignas( 32 ) Accumulator
+    {
+    public:
+        short values[ 2 ][ HIDDEN ];
+    };
+
+    /// <summary>
+    /// A piece put on, or taken off, the board
+    /// </summary>
+    class Change
+    {
+    public:
+        unsigned short piece;
+        unsigned long square;
+    };
+
+private:
+    // Identifies a network file, ahead of its version and layer sizes
+    static const char MAGIC[ 4 ];
+    static const unsigned int VERSION = 1;
+
+    // Hidden layer sums are scaled down by this many bits before clipping, and the output divided by this to give
+    // centipawns
+    static const int WEIGHT_SHIFT = 6;
+    static const int OUTPUT_SCALE = 16;
+
+    static bool loaded;
+    static std::string loadedFile;
+
+    // First layer - 16-bit, as the accumulator sums many of them
+    static std::vector<short> featureBiases;
+    static std::vector<short> featureWeights;
+
+    // Later layers - 8-bit weights, laid out by output, then input
+    static std::vector<int> layer2Biases;
+    static std::vector<signed char> layer2Weights;
+    static std::vector<int> layer3Biases;
+    static std::vector<signed char> layer3Weights;
+    static int outputBias;
+    static std::vector<signed char> outputWeights;
+
+    /// <summary>
+    /// Clip one perspective's accumulator to 0-127, as the input to the next layer
+    /// </summary>
+    static void clip( const short* values, unsigned char* output );
+
+    /// <summary>
+    /// Dot product of 8-bit inputs (0-127) and weights, of a length that is a multiple of 32
+    /// </summary>
+    static int dot( const unsigned char* input, const signed char* weights, unsigned int length );
+
+    /// <summary>
+    /// A hidden layer - weighted sums, scaled down and clipped to 0-127 for the layer after
+    /// </summary>
+    static void hiddenLayer( const unsigned char* input, unsigned int inputs, const std::vector<int>& biases, const std::vector<signed char>& weights, unsigned char* output, unsigned int outputs );
+
+public:
+    /// <summary>
+    /// Read a network from a file: the magic "MCNN", a 32-bit version, the four layer sizes as 32-bit values, then each
+    /// layer's biases and weights in turn, all little-endian. The sizes must match those above. On failure, whatever
+    /// network was loaded before is kept
+    /// </summary>
+    /// <param name="filename">the network file</param>
+    /// <returns>true if the network was loaded</returns>
+    static bool load( const std::string& filename );
+
+    inline static bool isLoaded()
+    {
+        return loaded;
+    }
+
+    inline static const std::string& getLoadedFile()
+    {
+        return loadedFile;
+    }
+
+    /// <summary>
+    /// The first layer input for a piece on a square, from one side's point of view. Black sees the board flipped, so
+    /// that the same situation uses the same weights for either side
+    /// </summary>
+    /// <param name="perspective">0 for white's point of view, 1 for black's</param>
+    /// <param name="kingSquare">square of the king of the side whose point of view this is</param>
+    /// <param name="piece">the piece, by bitboard array index - not a king</param>
+    /// <param name="square">the piece's square</param>
+    /// <returns>the feature index</returns>
+    inline static unsigned int featureIndex( unsigned short perspective, unsigned long kingSquare, unsigned short piece, unsigned long square )
+    {
+        const unsigned long flip = perspective == 0 ? 0 : 56;
+        const bool whitePiece = piece < 7;
+        const unsigned short type = whitePiece ? piece - 1 : piece - 7;
+        const unsigned short side = whitePiece == ( perspective == 0 ) ? 0 : 5;
+
+        return static_cast<unsigned int>( ( kingSquare ^ flip ) * PIECE_SQUARES + ( side + type ) * 64 + ( square ^ flip ) );
+    }
+
+    /// <summary>
+    /// Work out one perspective of an accumulator from scratch
+    /// </summary>
+    /// <param name="values">the perspective's values to fill in</param>
+    /// <param name="features">the active features</param>
+    /// <param name="count">number of features</param>
+    static void refresh( short* values, const unsigned int* features, unsigned int count );
+
+    /// <summary>
+    /// Work out one perspective of an accumulator from the one before it, given the features a move added and removed
+    /// </summary>
+    static void update( short* values, const short* previous, const unsigned int* added, unsigned int addedCount, const unsigned int* removed, unsigned int removedCount );
+
+    /// <summary>
+    /// Run the rest of the network on an accumulator
+    /// </summary>
+    /// <param name="accumulator">the accumulator for the position</param>
+    /// <param name="perspective">the side to move, 0 for white or 1 for black, whose point of view goes in first</param>
+    /// <returns>the score for the side to move, in centipawns</returns>
+    static short evaluate( const Accumulator& accumulator, unsigned short perspective );
+};
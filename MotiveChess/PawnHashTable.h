@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/// <summary>
+/// Pawn-structure scores, keyed by a Zobrist key of the pawns alone. The pawns change far less often than the rest of
+/// the position, so nearly every evaluation finds its pawn structure already scored here. Each search thread has its
+/// own table, so there is nothing shared to guard
+/// </summary>
+class PawnHashTable
+{
+public:
+    static const size_t ENTRIES = 1 << 14;
+
+    class Entry
+    {
+    public:
+        unsigned long long key;
+
+        // Passed pawns of both colours - a pawn's colour is that of the pawns it is found among
+        unsigned long long passedPawns;
+
+        // From white's point of view
+        short middlegameScore;
+        short endgameScore;
+
+        Entry() :
+            key( 0 ),
+            passedPawns( 0 ),
+            middlegameScore( 0 ),
+            endgameScore( 0 )
+        {
+        }
+    };
+
+private:
+    std::vector<Entry> entries;
+
+    size_t probes;
+    size_t hits;
+
+public:
+    PawnHashTable() :
+        entries( ENTRIES ),
+        probes( 0 ),
+        hits( 0 )
+    {
+    }
+
+    /// <summary>
+    /// The entry for a pawn key. With no pawns at all the key is zero, which an empty entry already holds the right
+    /// (empty) scores for
+    /// </summary>
+    /// <param name="key">the pawn key</param>
+    /// <param name="found">set to whether the entry holds the scores for this key - if not, it is for the caller to fill in</param>
+    /// <returns>the entry</returns>
+    inline Entry& probe( unsigned long long key, bool& found )
+    {
+        Entry& entry = entries[ key & ( ENTRIES - 1 ) ];
+
+        probes++;
+        found = entry.key == key;
+        if ( found )
+        {
+            hits++;
+        }
+
+        return entry;
+    }
+
+    /// <summary>
+    /// Start counting probes and hits afresh, for a new search
+    /// </summary>
+    inline void resetCounts()
+    {
+        probes = 0;
+        hits = 0;
+    }
+
+    inline size_t getProbes() const
+    {
+        return probes;
+    }
+
+    inline size_t getHits() const
+    {
+        return hits;
+    }
+};
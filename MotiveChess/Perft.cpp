@@ -1,13 +1,23 @@
 #include "Perft.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <stdint.h>
+#include <vector>
 
+#include "Allocations.h"
 #include "Fen.h"
 
-bool Perft::perftDepth( int depth, const std::string& fen, bool divide )
+// Check the incremental hash key against a full recalculation at every node. This is expensive,
+// so is only on by default in debug builds
+#if _DEBUG
+#define VERIFY_HASH
+#endif
+
+bool Perft::perftDepth( int depth, const std::string& fen, bool divide, Generator generator )
 {
     if ( depth < 1 )
     {
@@ -22,13 +32,13 @@ bool Perft::perftDepth( int depth, const std::string& fen, bool divide )
 
     std::cout << fen << std::endl;
 
-    unsigned int actualResult = perftRun( depth, fen, divide );
+    unsigned int actualResult = perftRun( depth, fen, divide, generator );
     std::cout << "  Depth: " << depth << ". Actual: " << actualResult << std::endl;
 
     return true;
 }
 
-bool Perft::perftFen( const std::string& fenWithResults, bool divide )
+bool Perft::perftFen( const std::string& fenWithResults, bool divide, Generator generator )
 {
     if ( fenWithResults.empty() )
     {
@@ -63,7 +73,7 @@ bool Perft::perftFen( const std::string& fenWithResults, bool divide )
             if ( split != SIZE_MAX )
             {
                 depth = atoi( token.substr( 0, split ).c_str() );
-                actualResult = perftRun( depth, fen, divide );
+                actualResult = perftRun( depth, fen, divide, generator );
                 report( depth, atoi( token.substr( split + 1 ).c_str() ), actualResult );
             }
 
@@ -76,7 +86,7 @@ bool Perft::perftFen( const std::string& fenWithResults, bool divide )
         if ( split != SIZE_MAX )
         {
             depth = atoi( token.substr( 0, split ).c_str() );
-            actualResult = perftRun( depth, fen, divide );
+            actualResult = perftRun( depth, fen, divide, generator );
             report( depth, atoi( token.substr( split + 1 ).c_str() ), actualResult );
         }
     }
@@ -98,7 +108,7 @@ bool Perft::perftFen( const std::string& fenWithResults, bool divide )
         {
             token = results.substr( 0, pos );
 
-            actualResult = perftRun( depth, fen, divide );
+            actualResult = perftRun( depth, fen, divide, generator );
             report( depth, atoi( token.c_str() ), actualResult );
 
             results.erase( 0, pos + delimiter.length() );
@@ -107,7 +117,7 @@ bool Perft::perftFen( const std::string& fenWithResults, bool divide )
 
         // Get the last one
         token = results;
-        actualResult = perftRun( depth, fen, divide );
+        actualResult = perftRun( depth, fen, divide, generator );
         report( depth, atoi( token.c_str() ), actualResult );
     }
     else
@@ -119,7 +129,7 @@ bool Perft::perftFen( const std::string& fenWithResults, bool divide )
     return true;
 }
 
-bool Perft::perftFile( const std::string& filename, bool divide )
+bool Perft::perftFile( const std::string& filename, bool divide, Generator generator )
 {
     std::fstream file;
     file.open( filename, std::ios::in );
@@ -140,13 +150,13 @@ bool Perft::perftFile( const std::string& filename, bool divide )
         }
 
         // This just happens to do the processing we want, although we are not providing a depth this way
-        perftFen( line, divide );
+        perftFen( line, divide, generator );
     }
 
     return true;
 }
 
-unsigned int Perft::perftRun( int depth, const std::string& fen, bool divide )
+unsigned int Perft::perftRun( int depth, const std::string& fen, bool divide, Generator generator )
 {
     // Prep here
 
@@ -164,9 +174,11 @@ unsigned int Perft::perftRun( int depth, const std::string& fen, bool divide )
     // Run the test
 
     clock_t start = clock();
+    unsigned long long startAllocations = Allocations::getCount();
 
-    unsigned int nodes = divide ? divideLoop( depth, board ) : perftLoop( depth, board );
+    unsigned int nodes = divide ? divideLoop( depth, board, generator ) : perftLoop( depth, board, generator );
 
+    unsigned long long allocations = Allocations::getCount() - startAllocations;
     clock_t end = clock();
 
     // Tidy up and report
@@ -179,10 +191,15 @@ unsigned int Perft::perftRun( int depth, const std::string& fen, bool divide )
 
     std::cout << "  Found " << nodes << " nodes in " << elapsed << "s (" << lnps << " nps)" << std::endl;
 
+    if ( Allocations::isCounting() )
+    {
+        std::cout << "  Allocations: " << allocations << " (" << ( nodes == 0 ? 0 : static_cast<double>( allocations ) / nodes ) << " per node)" << std::endl;
+    }
+
     return nodes;
 }
 
-unsigned int Perft::divideLoop( int depth, Board* board )
+unsigned int Perft::divideLoop( int depth, Board* board, Generator generator )
 {
     unsigned int nodes = 0;
 
@@ -191,23 +208,26 @@ unsigned int Perft::divideLoop( int depth, Board* board )
         return 1;
     }
 
-    std::vector<Move> moves;
-    moves.reserve( 256 );
+    MoveList moves;
 
-    board->getMoves( moves );
+    generateMoves( board, moves, generator );
 
     // We could get an unfair advantage here by returning count of moves if depth is 1
     // but we'd need to (a) still think about the divide thing and (b) admit we were no
     // longer comparing like for like with motive-chess and it would be an meaningless win
 
     Board::State undo = Board::State( board );
-    for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+    for ( MoveList::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
     {
         const Move& move = *it;
 
         board->applyMove( move );
 
-        unsigned long moveNodes = perftLoop( depth - 1, board );
+#ifdef VERIFY_HASH
+        verifyHashKey( board, move );
+#endif
+
+        unsigned long moveNodes = perftLoop( depth - 1, board, generator );
         nodes += moveNodes;
 
         std::cout << "  " << move.toString() << " : " << moveNodes << " " << board->toString() << std::endl;
@@ -218,7 +238,7 @@ unsigned int Perft::divideLoop( int depth, Board* board )
     return nodes;
 }
 
-unsigned int Perft::perftLoop( int depth, Board* board )
+unsigned int Perft::perftLoop( int depth, Board* board, Generator generator )
 {
     unsigned int nodes = 0;
 
@@ -227,10 +247,9 @@ unsigned int Perft::perftLoop( int depth, Board* board )
         return 1;
     }
 
-    std::vector<Move> moves;
-    moves.reserve( 256 );
+    MoveList moves;
 
-    board->getMoves( moves );
+    generateMoves( board, moves, generator );
 
     if ( depth == 1 )
     {
@@ -242,19 +261,80 @@ unsigned int Perft::perftLoop( int depth, Board* board )
     // longer comparing like for like with motive-chess and it would be an meaningless win
 
     Board::State undo = Board::State( board );
-    for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+    for ( MoveList::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
     {
         const Move& move = *it;
 
         board->applyMove( move );
 
-        nodes += perftLoop( depth - 1, board );
+#ifdef VERIFY_HASH
+        verifyHashKey( board, move );
+#endif
+
+        nodes += perftLoop( depth - 1, board, generator );
 
         board->unmakeMove( undo );
     }
 
     return nodes;
 }
+
+void Perft::generateMoves( Board* board, MoveList& moves, Generator generator )
+{
+    if ( generator == Generator::LEGACY )
+    {
+        board->getMovesLegacy( moves );
+        return;
+    }
+
+    board->getMoves( moves );
+
+    if ( generator == Generator::CROSSCHECK )
+    {
+        MoveList legacyList;
+        board->getMovesLegacy( legacyList );
+
+        // Compare everything about the moves, not just from/to, so that the check flags are verified too
+        auto ordering = [] ( const Move& a, const Move& b )
+        {
+            return a.getBits() < b.getBits();
+        };
+
+        std::vector<Move> legalMoves( moves.cbegin(), moves.cend() );
+        std::vector<Move> legacyMoves( legacyList.cbegin(), legacyList.cend() );
+        std::sort( legalMoves.begin(), legalMoves.end(), ordering );
+        std::sort( legacyMoves.begin(), legacyMoves.end(), ordering );
+
+        if ( legalMoves != legacyMoves )
+        {
+            std::cout << "  **ERROR** Generator mismatch in " << board->toString() << std::endl;
+
+            std::vector<Move> difference;
+            std::set_difference( legalMoves.begin(), legalMoves.end(), legacyMoves.begin(), legacyMoves.end(), std::back_inserter( difference ), ordering );
+            for ( std::vector<Move>::const_iterator it = difference.cbegin(); it != difference.cend(); it++ )
+            {
+                std::cout << "    legal only : " << ( *it ).toString() << " (" << ( *it ).getBits() << ")" << std::endl;
+            }
+
+            difference.clear();
+            std::set_difference( legacyMoves.begin(), legacyMoves.end(), legalMoves.begin(), legalMoves.end(), std::back_inserter( difference ), ordering );
+            for ( std::vector<Move>::const_iterator it = difference.cbegin(); it != difference.cend(); it++ )
+            {
+                std::cout << "    legacy only: " << ( *it ).toString() << " (" << ( *it ).getBits() << ")" << std::endl;
+            }
+        }
+    }
+}
+
+void Perft::verifyHashKey( const Board* board, const Move& move )
+{
+    unsigned long long expected = board->computeHashKey();
+    if ( board->getHashKey() != expected )
+    {
+        std::cout << "  **ERROR** Hash key mismatch after " << move.toString() << " giving " << board->toString() << std::endl;
+    }
+}
+
 void Perft::report( int depth, unsigned int expected, unsigned int actual )
 {
     if ( expected != actual )
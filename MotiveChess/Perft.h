@@ -6,13 +6,40 @@
 
 class Perft
 {
+public:
+    /// <summary>
+    /// Which move generator to count the moves of
+    /// </summary>
+    enum class Generator
+    {
+        LEGAL,      // the legal move generator used by the search
+        LEGACY,     // the original make/unmake generator
+        CROSSCHECK  // both, reporting any position where they disagree
+    };
+
 private:
-    static unsigned int perftRun( int depth, const std::string& fen, bool divide );
-    static unsigned int divideLoop( int depth, Board* board );
-    static unsigned int perftLoop( int depth, Board* board );
+    static unsigned int perftRun( int depth, const std::string& fen, bool divide, Generator generator );
+    static unsigned int divideLoop( int depth, Board* board, Generator generator );
+    static unsigned int perftLoop( int depth, Board* board, Generator generator );
+
+    /// <summary>
+    /// Get the moves for the position from the selected generator. When cross-checking, both generators are
+    /// run and any difference in the moves (including their flags) is reported
+    /// </summary>
+    /// <param name="board">the position</param>
+    /// <param name="moves">the list to fill</param>
+    /// <param name="generator">the generator to use</param>
+    static void generateMoves( Board* board, MoveList& moves, Generator generator );
 
     static void report( int depth, unsigned int expected, unsigned int actual );
 
+    /// <summary>
+    /// Self-check for the incrementally maintained hash key - recalculates it from scratch and reports any difference
+    /// </summary>
+    /// <param name="board">the board to check</param>
+    /// <param name="move">the move that was just made (or unmade), for reporting</param>
+    static void verifyHashKey( const Board* board, const Move& move );
+
 public:
     /// <summary>
     /// Do a depth search with the provided FEN string and report the results
@@ -20,19 +47,19 @@ public:
     /// <param name="depth">the search depth</param>
     /// <param name="fen">the FEN string</param>
     /// <returns></returns>
-    static bool perftDepth( int depth, const std::string& fen, bool divide );
+    static bool perftDepth( int depth, const std::string& fen, bool divide, Generator generator = Generator::LEGAL );
 
     /// <summary>
     /// Read a FEN string and the expected results and perform a search to check for matching results
     /// </summary>
     /// <param name="fen">the FEN string, with expected results</param>
     /// <returns></returns>
-    static bool perftFen( const std::string& fenWithResults, bool divide );
+    static bool perftFen( const std::string& fenWithResults, bool divide, Generator generator = Generator::LEGAL );
 
     /// <summary>
     /// Read a file of FEN strings and pass them to <code>perftFen</code>
     /// </summary>
     /// <param name="filename">the file to read</param>
     /// <returns><code>false</code> if the file fails to open</returns>
-    static bool perftFile( const std::string& filename, bool divide );
+    static bool perftFile( const std::string& filename, bool divide, Generator generator = Generator::LEGAL );
 };
@@ -0,0 +1,44 @@
+#pragma once
+
+class PieceSquareTables
+{
+private:
+    // Indexed by bitboard array index (as used by Board) and then square, the value of a piece on a square with its
+    // material included, from white's point of view - so black's values are negative. The EMPTY row is left as zero
+    // so that adding or taking away an "empty" piece has no effect
+    static short middlegameValues[ 13 ][ 64 ];
+    static short endgameValues[ 13 ][ 64 ];
+
+    // How much each piece counts towards the game phase, also by bitboard array index
+    static short phaseWeights[ 13 ];
+
+    // What the tables above are built from, by piece (pawn to king). The king's material is the same for both sides,
+    // so is left out. Positional values are for white, laid out as the board is seen from white's side - a8 first
+    static const short MIDDLEGAME_MATERIAL[ 6 ];
+    static const short ENDGAME_MATERIAL[ 6 ];
+    static const short PHASE_WEIGHTS[ 6 ];
+    static const short MIDDLEGAME_TABLES[ 6 ][ 64 ];
+    static const short ENDGAME_TABLES[ 6 ][ 64 ];
+
+public:
+    // The phase with all the pieces on the board, which is pure middlegame. Nothing left but kings and pawns is pure
+    // endgame, and a score in between is blended from the two in proportion
+    static const short MAX_PHASE = 24;
+
+    static void initialize();
+
+    inline static short getMiddlegameValue( const unsigned short piece, const unsigned long index )
+    {
+        return middlegameValues[ piece ][ index ];
+    }
+
+    inline static short getEndgameValue( const unsigned short piece, const unsigned long index )
+    {
+        return endgameValues[ piece ][ index ];
+    }
+
+    inline static short getPhaseWeight( const unsigned short piece )
+    {
+        return phaseWeights[ piece ];
+    }
+};
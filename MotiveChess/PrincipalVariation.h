@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+#include "Move.h"
+
+/// <summary>
+/// A triangular table of the best line found from each ply of the search. Row 'ply' holds the principal variation from
+/// that ply onwards, built by prefixing the row below it with the best move, so the best line from the root is always
+/// to hand without any string handling in the search.
+/// Also keeps the moves made to reach the current node so that the line being searched can be traced
+/// </summary>
+class PrincipalVariation
+{
+public:
+    // Deeper than any search will get, and the search stops extending at this point
+    static const size_t MAX_PLY = 128;
+
+private:
+    std::array<std::array<Move, MAX_PLY>, MAX_PLY> table;
+    std::array<size_t, MAX_PLY> length;
+
+    std::array<Move, MAX_PLY> path;
+
+public:
+    PrincipalVariation()
+    {
+        length.fill( 0 );
+    }
+
+    /// <summary>
+    /// Empty the line from this ply - call this before searching a node at this ply
+    /// </summary>
+    /// <param name="ply">distance from the root</param>
+    inline void clear( size_t ply )
+    {
+        length[ ply ] = ply;
+    }
+
+    /// <summary>
+    /// Make this move, followed by the line found at the next ply, the best line from this ply.
+    /// The next ply must have been cleared before its node was searched
+    /// </summary>
+    /// <param name="ply">distance from the root</param>
+    /// <param name="move">the best move at this ply</param>
+    inline void update( size_t ply, const Move& move )
+    {
+        table[ ply ][ ply ] = move;
+
+        for ( size_t loop = ply + 1; loop < length[ ply + 1 ]; loop++ )
+        {
+            table[ ply ][ loop ] = table[ ply + 1 ][ loop ];
+        }
+
+        length[ ply ] = length[ ply + 1 ];
+    }
+
+    /// <summary>
+    /// The number of moves in the best line from the root
+    /// </summary>
+    inline size_t size() const
+    {
+        return length[ 0 ];
+    }
+
+    /// <summary>
+    /// A move from the best line from the root
+    /// </summary>
+    /// <param name="index">the position in the line, zero being the move to make</param>
+    inline const Move& operator[]( size_t index ) const
+    {
+        return table[ 0 ][ index ];
+    }
+
+    /// <summary>
+    /// Record the move made at this ply to reach the next node
+    /// </summary>
+    /// <param name="ply">distance from the root</param>
+    /// <param name="move">the move being searched</param>
+    inline void setPathMove( size_t ply, const Move& move )
+    {
+        path[ ply ] = move;
+    }
+
+    /// <summary>
+    /// The move made at this ply to reach the next node
+    /// </summary>
+    /// <param name="ply">distance from the root</param>
+    inline const Move& getPathMove( size_t ply ) const
+    {
+        return path[ ply ];
+    }
+
+    /// <summary>
+    /// The best line from the root, in UCI format
+    /// </summary>
+    /// <returns>space separated moves</returns>
+    std::string toString() const
+    {
+        std::string line;
+        for ( size_t loop = 0; loop < length[ 0 ]; loop++ )
+        {
+            if ( loop > 0 )
+            {
+                line += " ";
+            }
+            line += table[ 0 ][ loop ].toString();
+        }
+
+        return line;
+    }
+
+    /// <summary>
+    /// The moves made from the root to reach a node at this ply - for tracing only
+    /// </summary>
+    /// <param name="ply">distance from the root</param>
+    /// <returns>space separated moves</returns>
+    std::string pathToString( size_t ply ) const
+    {
+        std::string line;
+        for ( size_t loop = 0; loop < ply; loop++ )
+        {
+            if ( loop > 0 )
+            {
+                line += " ";
+            }
+            line += path[ loop ].toString();
+        }
+
+        return line;
+    }
+};
@@ -78,6 +78,7 @@ void Test::runSuite( const Engine& engine, const std::string& filename )
     }
 
     printf( "Completed: success %d/%d (%0.2f%%)\n", stats.pass, ( stats.pass + stats.fail ), 100.0 * (float) stats.pass / (float)( stats.pass + stats.fail ) );
+    printf( "Pawn hash: hits %zu/%zu (%0.2f%%)\n", stats.pawnHashHits, stats.pawnHashProbes, stats.pawnHashProbes == 0 ? 0.0 : 100.0 * stats.pawnHashHits / stats.pawnHashProbes );
 }
 
 void Test::runSuite( const Engine& engine, const std::vector<Test::EPD> epdSuite, Test::Stats& stats )
@@ -93,8 +94,7 @@ void Test::runTest( const Engine& engine, const Test::EPD& epd, Test::Stats& sta
     // first things first, we need to change the piece notation for best move from (e.g. from Nc3 to b1c3)
     Board* board = Board::createBoard( epd.fen );
 
-    std::vector<Move> moves;
-    moves.reserve( 256 );
+    MoveList moves;
     board->getMoves( moves );
 
     std::vector<Move> matches;
@@ -117,7 +117,7 @@ void Test::runTest( const Engine& engine, const Test::EPD& epd, Test::Stats& sta
 
         Move match = Move::nullMove;
         unsigned short matchCount = 0;
-        for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+        for ( MoveList::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
         {
             std::string algebraicString = ( *it ).toAlgebriacString();
             std::string moveString = ( *it ).toString();
@@ -135,7 +135,7 @@ void Test::runTest( const Engine& engine, const Test::EPD& epd, Test::Stats& sta
 
         if ( matchCount != 1 )
         {
-            for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+            for ( MoveList::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
             {
                 std::string algebraicString = ( *it ).toAlgebriacString();
                 std::string moveString = ( *it ).toString();
@@ -168,9 +168,9 @@ void Test::runTest( const Engine& engine, const Test::EPD& epd, Test::Stats& sta
     printf( "Name: %s\n", epd.name.c_str() );
     printf( " FEN: %s\n", epd.fen.c_str() );
 
-    GoArguments goArgs = GoArguments::Builder().setDepth( 4 ).build();
+    GoArguments goArgs = GoArguments::Builder().setDepth( 5 ).build();
     Engine::Search search( *board, goArgs );
-    Engine::Search::start( &engine, &search, &search.stats, [engine,epd,&stats,matches] ( const Move& bestMove, const Move& ponderMove )
+    Engine::Search::start( &engine, &search, &search.stats, [&engine,epd,&stats,matches] ( const Move& bestMove, const Move& ponderMove )
     {
         printf( "EPD: %s : %s", epd.name.c_str(), bestMove.toAlgebriacString().c_str() );
 
@@ -190,4 +190,7 @@ void Test::runTest( const Engine& engine, const Test::EPD& epd, Test::Stats& sta
             stats.fail++;
         }
     } );
+
+    stats.pawnHashProbes += search.stats.pawnHashProbes;
+    stats.pawnHashHits += search.stats.pawnHashHits;
 }
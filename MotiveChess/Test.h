@@ -71,9 +71,15 @@ private:
         unsigned short pass;
         unsigned short fail;
 
+        // Totalled over the searches, for the pawn hash table hit rate
+        size_t pawnHashProbes;
+        size_t pawnHashHits;
+
         Stats() :
             pass( 0 ),
-            fail( 0 )
+            fail( 0 ),
+            pawnHashProbes( 0 ),
+            pawnHashHits( 0 )
         {
         }
     };
@@ -0,0 +1,73 @@
+#include "ThreadPool.h"
+
+ThreadPool::Worker::Worker() :
+    busy( false ),
+    quitting( false )
+{
+    thread = std::thread( &ThreadPool::Worker::loop, this );
+}
+
+void ThreadPool::Worker::loop()
+{
+    std::unique_lock<std::mutex> lock( mutex );
+    while ( true )
+    {
+        condition.wait( lock, [this] { return busy || quitting; } );
+
+        if ( quitting )
+        {
+            break;
+        }
+
+        // Run without holding the lock, so that wait() can be called while the job runs
+        std::function<void()> current;
+        current.swap( job );
+
+        lock.unlock();
+        current();
+        lock.lock();
+
+        busy = false;
+        condition.notify_all();
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    for ( std::vector<std::unique_ptr<Worker>>::iterator it = workers.begin(); it != workers.end(); it++ )
+    {
+        {
+            std::lock_guard<std::mutex> lock( ( *it )->mutex );
+            ( *it )->quitting = true;
+        }
+        ( *it )->condition.notify_all();
+        ( *it )->thread.join();
+    }
+}
+
+void ThreadPool::ensure( size_t count )
+{
+    while ( workers.size() < count )
+    {
+        workers.push_back( std::make_unique<Worker>() );
+    }
+}
+
+void ThreadPool::dispatch( size_t index, const std::function<void()>& job )
+{
+    Worker& worker = *workers[ index ];
+    {
+        std::lock_guard<std::mutex> lock( worker.mutex );
+        worker.job = job;
+        worker.busy = true;
+    }
+    worker.condition.notify_all();
+}
+
+void ThreadPool::wait( size_t index )
+{
+    Worker& worker = *workers[ index ];
+
+    std::unique_lock<std::mutex> lock( worker.mutex );
+    worker.condition.wait( lock, [&worker] { return !worker.busy; } );
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Long-lived threads that park between jobs, so that a search doesn't have to pay for starting and stopping threads.
+/// Each thread is addressed by index and runs one job at a time
+/// </summary>
+class ThreadPool
+{
+private:
+    class Worker
+    {
+    public:
+        std::mutex mutex;
+        std::condition_variable condition;
+
+        std::function<void()> job;
+        bool busy;
+        bool quitting;
+
+        std::thread thread;
+
+        Worker();
+
+        void loop();
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+public:
+    ~ThreadPool();
+
+    /// <summary>
+    /// Make sure there are at least this many threads. Only call this while no jobs are running
+    /// </summary>
+    /// <param name="count">the number of threads needed</param>
+    void ensure( size_t count );
+
+    inline size_t size() const
+    {
+        return workers.size();
+    }
+
+    /// <summary>
+    /// Hand a job to a thread, which must be idle - wait for it first if unsure
+    /// </summary>
+    /// <param name="index">the thread to run the job</param>
+    /// <param name="job">the job</param>
+    void dispatch( size_t index, const std::function<void()>& job );
+
+    /// <summary>
+    /// Wait for a thread to finish its job, if it has one
+    /// </summary>
+    /// <param name="index">the thread</param>
+    void wait( size_t index );
+};
@@ -0,0 +1,89 @@
+#include "TimeManager.h"
+
+const unsigned int TimeManager::MOVE_OVERHEAD_MS = 20;
+const unsigned int TimeManager::DEFAULT_MOVES_TO_GO = 30;
+const unsigned int TimeManager::MAX_MOVES_TO_GO = 50;
+
+TimeManager::TimeManager( const GoArguments& goArgs, bool whiteToMove ) :
+    startTime( std::chrono::steady_clock::now() ),
+    timed( false ),
+    baseSoftLimit( 0 ),
+    softLimit( 0 ),
+    hardLimit( 0 ),
+    pollCount( 0 ),
+    expired( false ),
+    stopSignal( nullptr )
+{
+    const long long clock = whiteToMove ? goArgs.getWTime() : goArgs.getBTime();
+    const long long increment = whiteToMove ? goArgs.getWInc() : goArgs.getBInc();
+
+    if ( goArgs.isPonder() )
+    {
+        // Our clock isn't running while we ponder, and we'll be told when to stop
+    }
+    else if ( goArgs.getMoveTime() > 0 )
+    {
+        timed = true;
+
+        // Use all of it, less the overhead
+        hardLimit = goArgs.getMoveTime() > MOVE_OVERHEAD_MS ? goArgs.getMoveTime() - MOVE_OVERHEAD_MS : 1;
+        softLimit = hardLimit;
+    }
+    else if ( clock > 0 )
+    {
+        timed = true;
+
+        long long movesToGo = goArgs.getMovesToGo() == 0 ? DEFAULT_MOVES_TO_GO : goArgs.getMovesToGo();
+        if ( movesToGo > MAX_MOVES_TO_GO )
+        {
+            movesToGo = MAX_MOVES_TO_GO;
+        }
+
+        const long long usable = clock > MOVE_OVERHEAD_MS ? clock - MOVE_OVERHEAD_MS : 1;
+
+        // An even share of the clock, plus most of the increment, with up to four times that for an unsettled position -
+        // but never so much that there isn't a decent amount left for the next move, unless this is the last move
+        // before the time control
+        softLimit = clock / movesToGo + increment * 3 / 4;
+        hardLimit = softLimit * 4;
+
+        const long long ceiling = movesToGo > 1 ? usable / 2 : usable;
+        if ( hardLimit > ceiling )
+        {
+            hardLimit = ceiling;
+        }
+        if ( softLimit > hardLimit )
+        {
+            softLimit = hardLimit;
+        }
+    }
+
+    baseSoftLimit = softLimit;
+}
+
+long long TimeManager::elapsed() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime ).count();
+}
+
+bool TimeManager::poll() const
+{
+    return elapsed() >= hardLimit;
+}
+
+bool TimeManager::canStartIteration() const
+{
+    return !expired && !stopSignalled() && ( !timed || elapsed() < softLimit );
+}
+
+void TimeManager::iterationComplete( bool bestMoveChanged )
+{
+    if ( timed && bestMoveChanged )
+    {
+        softLimit += baseSoftLimit / 2;
+        if ( softLimit > hardLimit )
+        {
+            softLimit = hardLimit;
+        }
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include "GoArguments.h"
+
+class TimeManager
+{
+private:
+    // Number of calls to checkTime between looks at the clock
+    static const unsigned int POLL_INTERVAL = 1024;
+
+    // Time kept back from the clock to allow for communication with the GUI
+    static const unsigned int MOVE_OVERHEAD_MS;
+
+    // Moves assumed to be left until the next time control when we aren't told
+    static const unsigned int DEFAULT_MOVES_TO_GO;
+    static const unsigned int MAX_MOVES_TO_GO;
+
+    std::chrono::steady_clock::time_point startTime;
+
+    bool timed;
+    long long baseSoftLimit;
+    long long softLimit;
+    long long hardLimit;
+
+    unsigned int pollCount;
+    bool expired;
+
+    // Set by another thread to stop a search that would otherwise carry on
+    const std::atomic<bool>* stopSignal;
+
+    /// <summary>
+    /// Look at the clock
+    /// </summary>
+    /// <returns>true if the hard limit has passed</returns>
+    bool poll() const;
+
+    /// <summary>
+    /// Whether the stop signal has been raised. Nothing is published along with the flag, so a relaxed load will do -
+    /// and is no dearer than reading a plain bool
+    /// </summary>
+    inline bool stopSignalled() const
+    {
+        return stopSignal != nullptr && stopSignal->load( std::memory_order_relaxed );
+    }
+
+public:
+    /// <summary>
+    /// Work out how long to spend on this move. The soft limit is the point after which no new iteration is started,
+    /// the hard limit is the point at which a search is abandoned. A search with no clock, or one that is pondering,
+    /// isn't timed
+    /// </summary>
+    /// <param name="goArgs">the arguments to 'go'</param>
+    /// <param name="whiteToMove">whose clock we are on</param>
+    TimeManager( const GoArguments& goArgs, bool whiteToMove );
+
+    inline bool isTimed() const
+    {
+        return timed;
+    }
+
+    inline long long getSoftLimit() const
+    {
+        return softLimit;
+    }
+
+    inline long long getHardLimit() const
+    {
+        return hardLimit;
+    }
+
+    /// <summary>
+    /// Time since the search started
+    /// </summary>
+    /// <returns>elapsed milliseconds</returns>
+    long long elapsed() const;
+
+    /// <summary>
+    /// Called at every node. Checks the stop signal every time, so a stop is seen within a node, but only looks at the
+    /// clock once every POLL_INTERVAL calls, so is cheap enough for the search to call as often as it likes
+    /// </summary>
+    /// <returns>true if the search has been stopped or the hard limit reached, and the search should be abandoned</returns>
+    inline bool checkTime()
+    {
+        if ( !expired )
+        {
+            expired = stopSignalled() || ( timed && ( ++pollCount & ( POLL_INTERVAL - 1 ) ) == 0 && poll() );
+        }
+
+        return expired;
+    }
+
+    /// <summary>
+    /// Treat the search as out of time as soon as this flag is set - the engine's stop flag for the main search thread,
+    /// and for helper threads a flag raised when the main search thread is done
+    /// </summary>
+    /// <param name="signal">the flag to watch</param>
+    inline void setStopSignal( const std::atomic<bool>* signal )
+    {
+        stopSignal = signal;
+    }
+
+    /// <summary>
+    /// Whether the search was stopped, or the hard limit was found to have passed by the last look at the clock
+    /// </summary>
+    inline bool hasExpired() const
+    {
+        return expired;
+    }
+
+    /// <summary>
+    /// Whether there is time for another iteration of the search
+    /// </summary>
+    /// <returns>true if untimed, or the soft limit is still to come</returns>
+    bool canStartIteration() const;
+
+    /// <summary>
+    /// Report the end of an iteration. If the best move has changed, the position is not yet understood and
+    /// is worth more time, so the soft limit is pushed out
+    /// </summary>
+    /// <param name="bestMoveChanged">whether the iteration picked a different best move to the one before</param>
+    void iterationComplete( bool bestMoveChanged );
+};
@@ -0,0 +1,150 @@
+#include "TranspositionTable.h"
+
+#include <limits>
+
+const size_t TranspositionTable::DEFAULT_SIZE_MB = 16;
+const size_t TranspositionTable::MIN_SIZE_MB = 1;
+const size_t TranspositionTable::MAX_SIZE_MB = 4096;
+
+TranspositionTable::TranspositionTable() :
+    bucketMask( 0 ),
+    generation( 0 ),
+    tornReads( 0 )
+{
+    resize( DEFAULT_SIZE_MB );
+}
+
+void TranspositionTable::resize( size_t megabytes )
+{
+    megabytes = megabytes < MIN_SIZE_MB ? MIN_SIZE_MB : megabytes > MAX_SIZE_MB ? MAX_SIZE_MB : megabytes;
+
+    // Largest power of two number of buckets that fits in the requested size
+    size_t count = 1;
+    while ( ( count << 1 ) * sizeof( Bucket ) <= megabytes * 1024 * 1024 )
+    {
+        count <<= 1;
+    }
+
+    // Release the old memory before allocating the new. The entries are atomic, so can't be copied or
+    // moved - the vector has to be created at its final size
+    std::vector<Bucket>().swap( buckets );
+    std::vector<Bucket>( count ).swap( buckets );
+
+    bucketMask = count - 1;
+}
+
+void TranspositionTable::clear()
+{
+    for ( std::vector<Bucket>::iterator it = buckets.begin(); it != buckets.end(); it++ )
+    {
+        for ( unsigned short loop = 0; loop < ENTRIES_PER_BUCKET; loop++ )
+        {
+            ( *it ).entries[ loop ].key.store( 0, std::memory_order_relaxed );
+            ( *it ).entries[ loop ].data.store( 0, std::memory_order_relaxed );
+        }
+    }
+
+    generation = 0;
+    tornReads = 0;
+}
+
+void TranspositionTable::newSearch()
+{
+    generation = ( generation + 1 ) & 0b00111111;
+}
+
+bool TranspositionTable::probe( unsigned long long key, Move& move, short& score, unsigned short& depth, Bound& bound ) const
+{
+    const Bucket& bucket = buckets[ key & bucketMask ];
+
+    for ( unsigned short loop = 0; loop < ENTRIES_PER_BUCKET; loop++ )
+    {
+        const Entry& entry = bucket.entries[ loop ];
+
+        // Each word is read atomically, but the pair is not - the XOR check covers that
+        const unsigned long long data = entry.data.load( std::memory_order_relaxed );
+        const unsigned long long check = entry.key.load( std::memory_order_relaxed );
+
+        if ( data == 0 )
+        {
+            continue;
+        }
+
+        if ( ( check ^ data ) == key )
+        {
+            move = unpackMove( data );
+            score = unpackScore( data );
+            depth = unpackDepth( data );
+            bound = unpackBound( data );
+
+            return true;
+        }
+
+        // The data was written for this position, but the key word came from a different write
+        if ( sameSignature( key, data ) )
+        {
+            tornReads.fetch_add( 1, std::memory_order_relaxed );
+        }
+    }
+
+    return false;
+}
+
+void TranspositionTable::store( unsigned long long key, const Move& move, short score, unsigned short depth, Bound bound )
+{
+    Bucket& bucket = buckets[ key & bucketMask ];
+
+    const unsigned char currentGeneration = generation;
+
+    // Prefer the slot already holding this position, then an empty slot, then the least valuable slot -
+    // where older and shallower entries are worth less.
+    // Another thread may be doing the same thing with this bucket - the worst that happens is one of the
+    // writes is lost, or a torn entry is left behind that fails the key check when read
+    Entry* replace = &bucket.entries[ 0 ];
+    unsigned long long replaceData = 0;
+    int lowestWorth = std::numeric_limits<int>::max();
+
+    for ( unsigned short loop = 0; loop < ENTRIES_PER_BUCKET; loop++ )
+    {
+        Entry& entry = bucket.entries[ loop ];
+
+        const unsigned long long data = entry.data.load( std::memory_order_relaxed );
+        const unsigned long long check = entry.key.load( std::memory_order_relaxed );
+
+        if ( data != 0 && ( check ^ data ) == key )
+        {
+            replace = &entry;
+            replaceData = data;
+            break;
+        }
+
+        if ( data == 0 )
+        {
+            replace = &entry;
+            replaceData = 0;
+            lowestWorth = std::numeric_limits<int>::lowest();
+            continue;
+        }
+
+        const int age = ( currentGeneration - unpackGeneration( data ) ) & 0b00111111;
+        const int worth = unpackDepth( data ) - ( age << 3 );
+        if ( worth < lowestWorth )
+        {
+            replace = &entry;
+            replaceData = 0;
+            lowestWorth = worth;
+        }
+    }
+
+    // Don't lose a best move just because this search of the same position didn't produce one
+    Move storeMove = move;
+    if ( storeMove.isNullMove() && replaceData != 0 )
+    {
+        storeMove = unpackMove( replaceData );
+    }
+
+    const unsigned long long data = pack( key, storeMove, score, depth, bound, currentGeneration );
+
+    replace->key.store( key ^ data, std::memory_order_relaxed );
+    replace->data.store( data, std::memory_order_relaxed );
+}
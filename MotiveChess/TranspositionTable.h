@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "Move.h"
+
+class TranspositionTable
+{
+public:
+    enum class Bound
+    {
+        NONE,
+        UPPER,
+        LOWER,
+        EXACT
+    };
+
+    static const size_t DEFAULT_SIZE_MB;
+    static const size_t MIN_SIZE_MB;
+    static const size_t MAX_SIZE_MB;
+
+private:
+    static const unsigned short ENTRIES_PER_BUCKET = 4;
+
+    /// <summary>
+    /// A key and its packed data, readable and writable from any number of search threads without locking.
+    /// The key word holds the position key XORed with the data word, so if another thread changes the entry
+    /// part way through a read, the two words will not reproduce the key and the entry is ignored rather than
+    /// trusted.
+    /// The data word holds:
+    ///  bits  0-15 : move (from, to and promotion only)
+    ///  bits 16-31 : score (relative to the side to move, mate scores adjusted to be relative to this node)
+    ///  bits 32-39 : depth
+    ///  bits 40-41 : bound
+    ///  bits 42-47 : generation (search counter) used to age out old entries
+    ///  bits 48-63 : top 16 bits of the position key, used to recognise torn reads
+    /// </summary>
+    class Entry
+    {
+    public:
+        std::atomic<unsigned long long> key;
+        std::atomic<unsigned long long> data;
+
+        Entry() :
+            key( 0 ),
+            data( 0 )
+        {
+        }
+    };
+
+    // Sized and aligned so that a bucket occupies exactly one cache line
+    class alignas( 64 ) Bucket
+    {
+    public:
+        Entry entries[ ENTRIES_PER_BUCKET ];
+    };
+
+    std::vector<Bucket> buckets;
+
+    // Number of buckets is a power of two, so this selects a bucket from a key
+    unsigned long long bucketMask;
+
+    std::atomic<unsigned char> generation;
+
+    // Reads where the data belonged to the position being probed but the key check failed - which means another
+    // thread was writing the entry at the same time
+    mutable std::atomic<unsigned long long> tornReads;
+
+    inline static unsigned long long pack( unsigned long long key, const Move& move, short score, unsigned short depth, Bound bound, unsigned char generation )
+    {
+        return static_cast<unsigned long long>( move.getBits() & Move::COMPARABLE_MASK ) |
+            ( static_cast<unsigned long long>( static_cast<unsigned short>( score ) ) << 16 ) |
+            ( static_cast<unsigned long long>( depth > 255 ? 255 : depth ) << 32 ) |
+            ( static_cast<unsigned long long>( bound ) << 40 ) |
+            ( static_cast<unsigned long long>( generation & 0b00111111 ) << 42 ) |
+            ( key & 0xffff000000000000ull );
+    }
+
+    inline static Move unpackMove( unsigned long long data )
+    {
+        const unsigned long moveBits = data & 0xffff;
+
+        return Move( ( moveBits & Move::FROM_MASK ) >> 6, moveBits & Move::TO_MASK, moveBits & Move::PROMOTION_MASK );
+    }
+
+    inline static short unpackScore( unsigned long long data )
+    {
+        return static_cast<short>( ( data >> 16 ) & 0xffff );
+    }
+
+    inline static unsigned short unpackDepth( unsigned long long data )
+    {
+        return ( data >> 32 ) & 0xff;
+    }
+
+    inline static Bound unpackBound( unsigned long long data )
+    {
+        return static_cast<Bound>( ( data >> 40 ) & 0b00000011 );
+    }
+
+    inline static unsigned char unpackGeneration( unsigned long long data )
+    {
+        return ( data >> 42 ) & 0b00111111;
+    }
+
+    inline static bool sameSignature( unsigned long long key, unsigned long long data )
+    {
+        return ( ( key ^ data ) & 0xffff000000000000ull ) == 0;
+    }
+
+public:
+    TranspositionTable();
+
+    /// <summary>
+    /// Reallocate the table. Existing content is discarded
+    /// </summary>
+    /// <param name="megabytes">the size of the table, rounded down to a power of two number of buckets</param>
+    void resize( size_t megabytes );
+
+    /// <summary>
+    /// Remove all content from the table, e.g. for a new game
+    /// </summary>
+    void clear();
+
+    /// <summary>
+    /// Called at the start of each search so that entries from previous searches are preferred for replacement
+    /// </summary>
+    void newSearch();
+
+    /// <summary>
+    /// Look up a position
+    /// </summary>
+    /// <param name="key">the Zobrist key of the position</param>
+    /// <param name="move">set to the stored best move, which may be the null move. Only from, to and promotion are stored,
+    /// so compare this with generated moves using Move::isEquivalent</param>
+    /// <param name="score">set to the stored score, relative to the side to move</param>
+    /// <param name="depth">set to the depth the score was searched to</param>
+    /// <param name="bound">set to the type of score</param>
+    /// <returns>true if the position was found</returns>
+    bool probe( unsigned long long key, Move& move, short& score, unsigned short& depth, Bound& bound ) const;
+
+    /// <summary>
+    /// Store the result of searching a position
+    /// </summary>
+    /// <param name="key">the Zobrist key of the position</param>
+    /// <param name="move">the best move found, or the null move if none</param>
+    /// <param name="score">the score, relative to the side to move</param>
+    /// <param name="depth">the depth searched</param>
+    /// <param name="bound">the type of score</param>
+    void store( unsigned long long key, const Move& move, short score, unsigned short depth, Bound bound );
+
+    /// <summary>
+    /// Number of probes discarded because another thread changed the entry while it was being read
+    /// </summary>
+    unsigned long long getTornReads() const
+    {
+        return tornReads.load( std::memory_order_relaxed );
+    }
+
+    /// <summary>
+    /// Size of the table in bytes
+    /// </summary>
+    size_t size() const
+    {
+        return buckets.size() * sizeof( Bucket );
+    }
+};
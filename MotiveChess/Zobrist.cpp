@@ -0,0 +1,59 @@
+#include "Zobrist.h"
+
+unsigned long long Zobrist::pieceKeys[ 13 ][ 64 ];
+
+unsigned long long Zobrist::pawnKeys[ 13 ][ 64 ];
+
+unsigned long long Zobrist::blackToMoveKey;
+
+unsigned long long Zobrist::castlingKeys[ 4 ];
+
+unsigned long long Zobrist::enPassantKeys[ 8 ];
+
+void Zobrist::initialize()
+{
+    // Fixed seed - any value will do, but it needs to be the same every time
+    unsigned long long state = 0x4d6f74697665ull;
+
+    for ( unsigned short square = 0; square < 64; square++ )
+    {
+        // Leave EMPTY (index 0) as zero
+        pieceKeys[ 0 ][ square ] = 0;
+
+        for ( unsigned short piece = 1; piece < 13; piece++ )
+        {
+            pieceKeys[ piece ][ square ] = nextRandom( state );
+        }
+    }
+
+    // White pawns are at bitboard array index 1 and black at 7
+    for ( unsigned short square = 0; square < 64; square++ )
+    {
+        for ( unsigned short piece = 0; piece < 13; piece++ )
+        {
+            pawnKeys[ piece ][ square ] = piece == 1 || piece == 7 ? pieceKeys[ piece ][ square ] : 0;
+        }
+    }
+
+    blackToMoveKey = nextRandom( state );
+
+    for ( unsigned short loop = 0; loop < 4; loop++ )
+    {
+        castlingKeys[ loop ] = nextRandom( state );
+    }
+
+    for ( unsigned short loop = 0; loop < 8; loop++ )
+    {
+        enPassantKeys[ loop ] = nextRandom( state );
+    }
+}
+
+unsigned long long Zobrist::nextRandom( unsigned long long& state )
+{
+    unsigned long long value = ( state += 0x9e3779b97f4a7c15ull );
+
+    value = ( value ^ ( value >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+    value = ( value ^ ( value >> 27 ) ) * 0x94d049bb133111ebull;
+
+    return value ^ ( value >> 31 );
+}
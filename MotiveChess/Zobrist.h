@@ -0,0 +1,59 @@
+#pragma once
+
+class Zobrist
+{
+private:
+    // Indexed by bitboard array index (as used by Board) and then square. The EMPTY row is left as zero so
+    // that XORing in an "empty" piece has no effect
+    static unsigned long long pieceKeys[ 13 ][ 64 ];
+
+    // The same keys for the pawns, and zero for everything else - so that a key of the pawns alone can be kept alongside
+    // the position key without having to test what is moving
+    static unsigned long long pawnKeys[ 13 ][ 64 ];
+
+    static unsigned long long blackToMoveKey;
+
+    static unsigned long long castlingKeys[ 4 ];
+
+    static unsigned long long enPassantKeys[ 8 ];
+
+    /// <summary>
+    /// Deterministic pseudo-random number generator (splitmix64) so that keys are the same from run to run
+    /// </summary>
+    /// <param name="state">generator state, updated by each call</param>
+    /// <returns>the next 64-bit value</returns>
+    static unsigned long long nextRandom( unsigned long long& state );
+
+public:
+    static void initialize();
+
+    inline static unsigned long long getPieceKey( const unsigned short piece, const unsigned long index )
+    {
+        return pieceKeys[ piece ][ index ];
+    }
+
+    inline static unsigned long long getPawnKey( const unsigned short piece, const unsigned long index )
+    {
+        return pawnKeys[ piece ][ index ];
+    }
+
+    inline static unsigned long long getBlackToMoveKey()
+    {
+        return blackToMoveKey;
+    }
+
+    inline static unsigned long long getCastlingKey( const unsigned short index )
+    {
+        return castlingKeys[ index ];
+    }
+
+    /// <summary>
+    /// The key for an en-passant square depends only on its file
+    /// </summary>
+    /// <param name="index">square index of the en-passant square</param>
+    /// <returns></returns>
+    inline static unsigned long long getEnPassantKey( const unsigned long index )
+    {
+        return enPassantKeys[ index & 7 ];
+    }
+};